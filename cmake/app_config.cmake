@@ -22,6 +22,10 @@ set (OONF_LOGGING_LEVEL debug CACHE STRING
 set (OONF_REMOVE_HELPTEXT false CACHE BOOL
      "Set if you want to remove the help texts from application to reduce size")
 
+# simulation build with a virtual clock (--Xvirtualclock), Linux only
+set (OONF_VIRTUAL_CLOCK false CACHE BOOL
+     "Set if you want a simulation build that can skip the idle time between timer events")
+
 ######################################
 #### Install target configuration ####
 ######################################
@@ -69,7 +73,7 @@ set (OONF_NEED_PACKETBB true)
 
 # use default static plugins if custom variable not set
 IF (NOT OONF_CUSTOM_STATIC_PLUGINS OR OONF_CUSTOM_STATIC_PLUGINS STREQUAL "")
-	set (OONF_STATIC_PLUGINS "cfgparser_compact cfgio_file ff_ett neighbor_probing nl80211_listener eth_listener auto_ll4")
+	set (OONF_STATIC_PLUGINS "cfgparser_compact cfgio_file ff_ett neighbor_probing nl80211_listener eth_listener auto_ll4 mpr")
 ELSE ()
 	set (OONF_STATIC_PLUGINS "${OONF_CUSTOM_STATIC_PLUGINS}")
 ENDIF ()
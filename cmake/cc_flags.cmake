@@ -61,6 +61,10 @@ IF (OONF_REMOVE_HELPTEXT)
     ADD_DEFINITIONS(-DREMOVE_HELPTEXT)
 ENDIF(OONF_REMOVE_HELPTEXT)
 
+IF (OONF_VIRTUAL_CLOCK)
+    ADD_DEFINITIONS(-DOONF_VIRTUAL_CLOCK)
+ENDIF(OONF_VIRTUAL_CLOCK)
+
 # OS-specific compiler settings
 IF(ANDROID OR WIN32)
     # Android and windows don't compile well with c99
@@ -0,0 +1,312 @@
+#!/bin/bash
+#
+# Emulates an olsrd2 mesh on a single Linux host.
+#
+# Every node of the topology gets its own network namespace with its
+# own kernel routing table and runs an unmodified olsrd2. Links are
+# veth pairs, netem adds the configured loss and latency. No network
+# access is necessary, but the script must run as root.
+#
+# usage: olsrd2_netsim.sh [-b olsrd2-binary] [-t timeout] [-k] topology-file
+#
+#   -b  olsrd2 binary (default: ./build/olsrd2)
+#   -t  maximum time in seconds to wait for convergence (default: 300)
+#   -k  keep the emulation running after the report, stop it with
+#       "olsrd2_netsim.sh -c topology-file"
+#   -c  stop all nodes and remove namespaces of a topology
+#
+# The topology file has one link per line:
+#
+#   <node-a> <node-b> [<loss-percent> [<delay-ms>]]
+#
+# Empty lines and lines starting with '#' are ignored. Node names are
+# created from the first time they are used.
+#
+# Each node announces a /32 address out of 10.0.0.0/8 as locally
+# attached network. The mesh has converged as soon as every node has
+# a route to the address of every other node. The script reports the
+# convergence time, the RFC5444 packets and messages sent by each node
+# (from the "nhdp interface" telnet command) and the CPU time used by
+# each olsrd2 process.
+#
+
+OLSRD2=./build/olsrd2
+TIMEOUT=300
+KEEP=0
+CLEANUP=0
+
+# telnet port of olsrd2, each namespace has its own loopback
+TELNET_PORT=2009
+
+# routing protocol number of olsrv2 routes
+RT_PROTO=100
+
+# prefix for namespace names
+NS_PREFIX=olsrsim
+
+WORKDIR=
+
+NODES=()
+declare -A NODE_INDEX
+declare -A NODE_IFACES
+LINKS=()
+
+usage() {
+	echo "usage: $0 [-b olsrd2-binary] [-t timeout] [-k] [-c] topology-file" >&2
+	exit 1
+}
+
+# node_addr <index>
+node_addr() {
+	local idx=$(($1 + 1))
+	echo "10.$((idx >> 16 & 255)).$((idx >> 8 & 255)).$((idx & 255))"
+}
+
+# link_addr <link index> <end (1 or 2)>
+link_addr() {
+	local addr=$((($1 << 2) + $2))
+	echo "172.$((16 + (addr >> 16 & 15))).$((addr >> 8 & 255)).$((addr & 255))"
+}
+
+# add_node <name>
+add_node() {
+	if [ -z "${NODE_INDEX[$1]}" ]
+	then
+		NODE_INDEX[$1]=${#NODES[@]}
+		NODES+=("$1")
+	fi
+}
+
+read_topology() {
+	local a b loss delay rest
+
+	while read -r a b loss delay rest
+	do
+		case "${a}" in
+			""|\#*)
+				continue
+				;;
+		esac
+		if [ -z "${b}" ]
+		then
+			echo "Bad link in topology file: ${a}" >&2
+			exit 1
+		fi
+
+		add_node "${a}"
+		add_node "${b}"
+		LINKS+=("${a} ${b} ${loss:-0} ${delay:-0}")
+	done < "$1"
+}
+
+# ns <node index>
+ns() {
+	echo "${NS_PREFIX}$1"
+}
+
+# setup_link <link index> <node-a> <node-b> <loss> <delay>
+setup_link() {
+	local i=$1 a=${NODE_INDEX[$2]} b=${NODE_INDEX[$3]} loss=$4 delay=$5
+	local end ns_x node_x
+
+	ip link add "simtmp${i}a" type veth peer name "simtmp${i}b" || exit 1
+
+	for end in 1 2
+	do
+		if [ ${end} = 1 ]
+		then
+			node_x=${a}
+			ip link set "simtmp${i}a" netns "$(ns ${a})" name "l${i}"
+		else
+			node_x=${b}
+			ip link set "simtmp${i}b" netns "$(ns ${b})" name "l${i}"
+		fi
+		ns_x=$(ns ${node_x})
+
+		ip -n "${ns_x}" addr add "$(link_addr ${i} ${end})/30" dev "l${i}"
+		ip -n "${ns_x}" link set "l${i}" up
+		if [ "${loss}" != 0 -o "${delay}" != 0 ]
+		then
+			ip netns exec "${ns_x}" tc qdisc add dev "l${i}" root netem \
+				loss "${loss}%" delay "${delay}ms"
+		fi
+
+		NODE_IFACES[${node_x}]="${NODE_IFACES[${node_x}]} l${i}"
+	done
+}
+
+# write_config <node index>
+write_config() {
+	local idx=$1 iface
+
+	echo "[global]"
+	echo "	fork	no"
+	echo "	lockfile	${WORKDIR}/node${idx}.lock"
+	echo
+	echo "[log]"
+	echo "	file	${WORKDIR}/node${idx}.log"
+	echo
+	echo "[olsrv2]"
+	echo "	lan	$(node_addr ${idx})/32"
+	echo
+	echo "[domain=0]"
+	echo "	protocol	${RT_PROTO}"
+	for iface in ${NODE_IFACES[${idx}]}
+	do
+		echo
+		echo "[interface=${iface}]"
+	done
+}
+
+setup() {
+	local i node
+
+	for i in "${!NODES[@]}"
+	do
+		ip netns add "$(ns ${i})" || exit 1
+		ip -n "$(ns ${i})" link set lo up
+		ip -n "$(ns ${i})" addr add "$(node_addr ${i})/32" dev lo
+	done
+
+	for i in "${!LINKS[@]}"
+	do
+		setup_link ${i} ${LINKS[${i}]}
+	done
+}
+
+start_nodes() {
+	local i
+
+	for i in "${!NODES[@]}"
+	do
+		write_config ${i} > "${WORKDIR}/node${i}.conf"
+		ip netns exec "$(ns ${i})" "${OLSRD2}" --Xignoreunknown \
+			--load "${WORKDIR}/node${i}.conf" > /dev/null 2>&1 &
+		echo $! > "${WORKDIR}/node${i}.pid"
+	done
+}
+
+cleanup() {
+	local ns_x pid
+
+	for ns_x in $(ip netns list | awk '{print $1}' | grep "^${NS_PREFIX}[0-9]*$")
+	do
+		for pid in $(ip netns pids "${ns_x}")
+		do
+			kill "${pid}" 2>/dev/null
+		done
+		ip netns del "${ns_x}"
+	done
+}
+
+# routes_missing <node index>: prints the number of missing node routes
+routes_missing() {
+	local count
+
+	count=$(ip -n "$(ns $1)" -4 route show proto ${RT_PROTO} \
+		| grep -c "^10\.[0-9.]* ")
+	echo $((${#NODES[@]} - 1 - count))
+}
+
+# telnet <node index> <command>
+telnet_cmd() {
+	printf "%s\nquit\n" "$2" \
+		| ip netns exec "$(ns $1)" nc -q 1 127.0.0.1 ${TELNET_PORT} 2>/dev/null
+}
+
+# cpu_time <pid>: prints user+system time in milliseconds
+cpu_time() {
+	local ticks
+
+	ticks=$(awk '{print $14 + $15}' "/proc/$1/stat" 2>/dev/null)
+	echo $((${ticks:-0} * 1000 / $(getconf CLK_TCK)))
+}
+
+report() {
+	local i pid packets messages total_packets=0 total_messages=0
+
+	printf "%-20s %10s %10s %10s\n" "node" "packets" "messages" "cpu(ms)"
+	for i in "${!NODES[@]}"
+	do
+		pid=$(cat "${WORKDIR}/node${i}.pid")
+		read -r packets messages <<< "$(telnet_cmd ${i} "nhdp interface" \
+			| awk '/Packets:/ {p += $2; m += $4} END {print p + 0, m + 0}')"
+
+		total_packets=$((total_packets + packets))
+		total_messages=$((total_messages + messages))
+		printf "%-20s %10d %10d %10d\n" "${NODES[${i}]}" \
+			"${packets}" "${messages}" "$(cpu_time ${pid})"
+	done
+	printf "%-20s %10d %10d\n" "total" "${total_packets}" "${total_messages}"
+}
+
+while getopts "b:t:kch" opt
+do
+	case ${opt} in
+		b) OLSRD2=${OPTARG} ;;
+		t) TIMEOUT=${OPTARG} ;;
+		k) KEEP=1 ;;
+		c) CLEANUP=1 ;;
+		*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+if [ ${CLEANUP} = 1 ]
+then
+	cleanup
+	exit 0
+fi
+
+if [ $# != 1 ]
+then
+	usage
+fi
+
+read_topology "$1"
+if [ ${#NODES[@]} = 0 ]
+then
+	echo "Topology file contains no links" >&2
+	exit 1
+fi
+
+WORKDIR=$(mktemp -d /tmp/olsrd2_netsim.XXXXXX)
+if [ ${KEEP} = 0 ]
+then
+	trap cleanup EXIT
+fi
+
+echo "Creating ${#NODES[@]} nodes and ${#LINKS[@]} links (files in ${WORKDIR})"
+setup
+
+START=$(date +%s%N)
+start_nodes
+
+CONVERGED=0
+while [ $((($(date +%s%N) - START) / 1000000000)) -lt ${TIMEOUT} ]
+do
+	CONVERGED=1
+	for i in "${!NODES[@]}"
+	do
+		if [ $(routes_missing ${i}) -gt 0 ]
+		then
+			CONVERGED=0
+			break
+		fi
+	done
+	if [ ${CONVERGED} = 1 ]
+	then
+		break
+	fi
+	sleep 0.5
+done
+
+TIME=$((($(date +%s%N) - START) / 1000000))
+if [ ${CONVERGED} = 1 ]
+then
+	echo "Converged after ${TIME} ms"
+else
+	echo "Not converged after ${TIME} ms"
+fi
+
+report
@@ -586,6 +586,17 @@ _nhdp_if_has_collision(struct nhdp_interface *nhdp_if, struct netaddr *addr) {
   struct nhdp_link *lnk;
   struct nhdp_laddr *laddr;
   struct nhdp_l2hop *l2hop;
+  struct nhdp_2hop *twohop;
+
+  /* check for collision with IPv4 two-hop neighbor */
+  twohop = nhdp_db_2hop_get(addr);
+  if (twohop != NULL) {
+    list_for_each_element(&twohop->_l2hops, l2hop, _2hop_node) {
+      if (l2hop->link->local_if == nhdp_if) {
+        return true;
+      }
+    }
+  }
 
   list_for_each_element(&nhdp_if->_links, lnk, _if_node) {
     /* check for collision with one-hop neighbor */
@@ -595,8 +606,10 @@ _nhdp_if_has_collision(struct nhdp_interface *nhdp_if, struct netaddr *addr) {
       }
     }
 
+    /* check for collision with hashed IPv6 two-hop neighbor */
     avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
-      if (_is_address_collision(addr, &l2hop->twohop_addr)) {
+      if (netaddr_get_address_family(&l2hop->twohop_addr) == AF_INET6
+          && _is_address_collision(addr, &l2hop->twohop_addr)) {
         return true;
       }
     }
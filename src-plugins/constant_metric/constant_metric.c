@@ -261,7 +261,7 @@ _cb_set_linkcost(void *ptr __attribute__((unused))) {
   }
 
   /* update neighbor metrics */
-  nhdp_domain_neighborhood_changed();
+  nhdp_domain_recalculate_metrics();
 }
 
 static int
@@ -397,7 +397,7 @@ _cb_ett_sampling(void *ptr __attribute__((unused))) {
   }
 
   /* update neighbor metrics */
-  nhdp_domain_neighborhood_changed();
+  nhdp_domain_recalculate_metrics();
 }
 
 /**
@@ -450,13 +450,13 @@ _cb_process_packet(struct rfc5444_reader_tlvblock_context *context) {
   }
 
   /* get interface and link */
-  interf = nhdp_interface_get(_protocol->input_interface->name);
+  interf = nhdp_interface_get_input();
   if (interf == NULL) {
     /* silently ignore unknown interface */
     return RFC5444_OKAY;
   }
 
-  laddr = nhdp_interface_get_link_addr(interf, _protocol->input_address);
+  laddr = nhdp_interface_get_input_laddr(interf);
   if (laddr == NULL) {
     /* silently ignore unknown link*/
     return RFC5444_OKAY;
@@ -0,0 +1,1248 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#include <stdlib.h>
+
+#include "common/common_types.h"
+#include "common/avl.h"
+#include "common/list.h"
+#include "common/netaddr.h"
+#include "config/cfg_schema.h"
+#include "core/oonf_cfg.h"
+#include "core/oonf_logging.h"
+#include "core/oonf_plugins.h"
+#include "rfc5444/rfc5444_iana.h"
+#include "subsystems/oonf_class.h"
+#include "subsystems/oonf_timer.h"
+
+#include "nhdp/nhdp.h"
+#include "nhdp/nhdp_db.h"
+#include "nhdp/nhdp_domain.h"
+#include "nhdp/nhdp_interfaces.h"
+
+#include "mpr/mpr.h"
+
+#define _MPR_CLASS_N2   "mpr two-hop address"
+#define _MPR_CLASS_PATH "mpr path"
+
+struct _config {
+  int32_t willingness;
+};
+
+/*
+ * State of one MPR set, either the routing MPRs of a domain or the
+ * flooding MPRs of an interface. It is kept between calculations and
+ * only the parts touched by a changed neighbor are updated.
+ */
+struct _mpr_set {
+  /* tree of _mpr_n2, key is the two-hop address */
+  struct avl_tree n2;
+
+  /* list of all active _mpr_n1 of this set */
+  struct list_entity n1;
+
+  /* list of _mpr_n2 whose paths changed since the last update */
+  struct list_entity dirty;
+
+  /* list of _mpr_n1 whose MPR setting might have changed */
+  struct list_entity touched;
+
+  /* true if the trees and lists have been initialized */
+  bool initialized;
+
+  /* true if the set ran out of memory and must be rebuilt */
+  bool failed;
+};
+
+/* symmetric one-hop neighbor that can be selected as a MPR (N1) */
+struct _mpr_n1 {
+  /* set this neighbor is part of, NULL if inactive */
+  struct _mpr_set *set;
+
+  /* NHDP neighbor, and its link for flooding MPRs */
+  struct nhdp_neighbor *neigh;
+  struct nhdp_link *lnk;
+
+  /* willingness of the neighbor */
+  uint8_t willingness;
+
+  /* true if neighbor has been selected as a MPR */
+  bool selected;
+
+  /* tree of _mpr_paths to two-hop addresses, key is the address */
+  struct avl_tree paths;
+
+  /* tree of _mpr_paths to the addresses of the neighbor itself */
+  struct avl_tree directs;
+
+  /* member of the n1 list of the set */
+  struct list_entity _node;
+
+  /* member of the touched list of the set */
+  struct list_entity _touched_node;
+};
+
+/* address that is reachable through one-hop neighbors (N2) */
+struct _mpr_n2 {
+  struct netaddr addr;
+
+  /* cost of the best two-hop path */
+  uint32_t d;
+
+  /* true if no direct link is as good as the best two-hop path */
+  bool required;
+
+  /* number of one-hop neighbors offering a best path */
+  size_t providers;
+
+  /* number of selected MPRs offering a best path */
+  size_t coverage;
+
+  /* list of _mpr_paths to this address */
+  struct list_entity paths;
+
+  /* member of the n2 tree of the set */
+  struct avl_node _node;
+
+  /* member of the dirty list of the set */
+  struct list_entity _dirty_node;
+};
+
+/* path from a one-hop neighbor to an address */
+struct _mpr_path {
+  struct _mpr_n1 *n1;
+  struct _mpr_n2 *n2;
+
+  /* total cost of the path */
+  uint32_t cost;
+
+  /* cost found by the running update */
+  uint32_t new_cost;
+
+  /* true if the address is one of the neighbors own addresses */
+  bool direct;
+
+  /* true if path is a best path to a required address */
+  bool best;
+
+  /* member of the paths or directs tree of the one-hop neighbor */
+  struct avl_node _n1_node;
+
+  /* member of the path list of the two-hop address */
+  struct list_entity _n2_node;
+};
+
+/* MPR data of a NHDP neighbor */
+struct _mpr_neighbor {
+  /* routing MPR candidate of each domain */
+  struct _mpr_n1 routing[NHDP_MAXIMUM_DOMAINS];
+};
+
+/* MPR data of a NHDP link */
+struct _mpr_link {
+  /* flooding MPR candidate on the interface of the link */
+  struct _mpr_n1 flooding;
+};
+
+/* MPR data of a NHDP interface */
+struct _mpr_interface {
+  /* flooding MPR set of the interface */
+  struct _mpr_set flooding;
+};
+
+/* prototypes */
+static int _init(void);
+static void _cleanup(void);
+
+static void _cb_update_routing_mpr(
+    struct nhdp_domain *, struct nhdp_neighbor *);
+static void _cb_update_flooding_mpr(
+    struct nhdp_domain *, struct nhdp_neighbor *);
+
+static void _update_routing_n1(
+    struct nhdp_domain *domain, struct nhdp_neighbor *neigh);
+static void _update_flooding_n1(
+    struct nhdp_domain *domain, struct nhdp_link *lnk);
+static void _update_flooding_result(struct nhdp_neighbor *neigh);
+static struct _mpr_set *_get_flooding_set(struct nhdp_interface *interf);
+
+static void _set_init(struct _mpr_set *set);
+static void _set_clear(struct _mpr_set *set);
+static void _set_update(struct _mpr_set *set);
+static void _n1_activate(struct _mpr_set *set, struct _mpr_n1 *n1,
+    struct nhdp_neighbor *neigh, struct nhdp_link *lnk, uint8_t willingness);
+static void _n1_deactivate(struct _mpr_n1 *n1);
+static void _n1_begin_update(struct _mpr_n1 *n1);
+static void _n1_add_path(struct _mpr_n1 *n1,
+    const struct netaddr *addr, uint32_t cost, bool direct);
+static void _n1_add_directs(struct _mpr_n1 *n1, uint32_t d1);
+static void _n1_end_update(struct _mpr_n1 *n1);
+static void _n2_update(struct _mpr_set *set, struct _mpr_n2 *n2);
+static void _set_dirty(struct _mpr_set *set, struct _mpr_n2 *n2);
+static void _set_dirty_all(struct _mpr_set *set);
+static void _set_touched(struct _mpr_set *set, struct _mpr_n1 *n1);
+static void _set_selected(struct _mpr_n1 *n1, bool selected);
+static void _remove_path(struct _mpr_path *path);
+static struct _mpr_n1 *_get_best_candidate(struct _mpr_set *set);
+static size_t _count_paths(struct _mpr_n1 *n1, bool only_uncovered);
+static bool _is_redundant(struct _mpr_n1 *n1);
+
+static void _cb_neighbor_removed(void *);
+static void _cb_link_removed(void *);
+static void _cb_interface_removed(void *);
+
+static void _cb_cfg_changed(void);
+
+/* plugin declaration */
+static struct cfg_schema_entry _mpr_entries[] = {
+  CFG_MAP_INT32_MINMAX(_config, willingness, "willingness", "7",
+      "Willingness of the router to be selected as a flooding"
+      " and routing MPR", 0, false,
+      RFC5444_WILLINGNESS_NEVER, RFC5444_WILLINGNESS_ALWAYS),
+};
+
+static struct cfg_schema_section _mpr_section = {
+  .type = OONF_PLUGIN_GET_NAME(),
+  .mode = CFG_SSMODE_UNNAMED,
+  .cb_delta_handler = _cb_cfg_changed,
+  .entries = _mpr_entries,
+  .entry_count = ARRAYSIZE(_mpr_entries),
+};
+
+struct oonf_subsystem olsrv2_mpr_subsystem = {
+  .name = OONF_PLUGIN_GET_NAME(),
+  .descr = "OLSRv2 flooding and routing MPR plugin (RFC 7181)",
+  .author = "Henning Rogge",
+
+  .cfg_section = &_mpr_section,
+
+  .init = _init,
+  .cleanup = _cleanup,
+};
+DECLARE_OONF_PLUGIN(olsrv2_mpr_subsystem);
+
+/* routing MPR handler, used by every domain that selects this plugin */
+static struct nhdp_domain_mpr _routing_mpr = {
+  .name = OONF_PLUGIN_GET_NAME(),
+  .update_mpr = _cb_update_routing_mpr,
+  .willingness = RFC5444_WILLINGNESS_DEFAULT,
+};
+
+/* flooding MPR handler, transported with the TLVs of domain 0 */
+static struct nhdp_domain_mpr _flooding_mpr = {
+  .name = OONF_PLUGIN_GET_NAME() " flooding",
+  .update_mpr = _cb_update_flooding_mpr,
+  .willingness = RFC5444_WILLINGNESS_DEFAULT,
+};
+
+/* MPR data of NHDP neighbors, links and interfaces */
+static struct oonf_class_extension _neighbor_extension = {
+  .ext_name = "mpr",
+  .class_name = NHDP_CLASS_NEIGHBOR,
+  .size = sizeof(struct _mpr_neighbor),
+
+  .cb_remove = _cb_neighbor_removed,
+};
+
+static struct oonf_class_extension _link_extension = {
+  .ext_name = "mpr",
+  .class_name = NHDP_CLASS_LINK,
+  .size = sizeof(struct _mpr_link),
+
+  .cb_remove = _cb_link_removed,
+};
+
+static struct oonf_class_extension _interface_extension = {
+  .ext_name = "mpr",
+  .class_name = NHDP_CLASS_INTERFACE,
+  .size = sizeof(struct _mpr_interface),
+
+  .cb_remove = _cb_interface_removed,
+};
+
+/* memory classes of the MPR sets */
+static struct oonf_class _n2_class = {
+  .name = _MPR_CLASS_N2,
+  .size = sizeof(struct _mpr_n2),
+};
+
+static struct oonf_class _path_class = {
+  .name = _MPR_CLASS_PATH,
+  .size = sizeof(struct _mpr_path),
+};
+
+/* routing MPR set of each domain */
+static struct _mpr_set _routing_sets[NHDP_MAXIMUM_DOMAINS];
+
+/**
+ * Initialize plugin
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_init(void) {
+  size_t i;
+
+  if (oonf_class_extension_add(&_neighbor_extension)) {
+    return -1;
+  }
+  if (oonf_class_extension_add(&_link_extension)) {
+    oonf_class_extension_remove(&_neighbor_extension);
+    return -1;
+  }
+  if (oonf_class_extension_add(&_interface_extension)) {
+    oonf_class_extension_remove(&_link_extension);
+    oonf_class_extension_remove(&_neighbor_extension);
+    return -1;
+  }
+
+  oonf_class_add(&_n2_class);
+  oonf_class_add(&_path_class);
+
+  for (i = 0; i < NHDP_MAXIMUM_DOMAINS; i++) {
+    _set_init(&_routing_sets[i]);
+  }
+
+  if (nhdp_domain_mpr_add(&_routing_mpr)) {
+    oonf_class_remove(&_path_class);
+    oonf_class_remove(&_n2_class);
+    oonf_class_extension_remove(&_interface_extension);
+    oonf_class_extension_remove(&_link_extension);
+    oonf_class_extension_remove(&_neighbor_extension);
+    return -1;
+  }
+
+  nhdp_domain_set_flooding_mpr(&_flooding_mpr, 0);
+  return 0;
+}
+
+/**
+ * Cleanup plugin
+ */
+static void
+_cleanup(void) {
+  struct nhdp_interface *interf;
+  size_t i;
+
+  nhdp_domain_set_flooding_mpr(NULL, 0);
+  nhdp_domain_mpr_remove(&_routing_mpr);
+
+  avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+    _set_clear(_get_flooding_set(interf));
+  }
+  for (i = 0; i < NHDP_MAXIMUM_DOMAINS; i++) {
+    _set_clear(&_routing_sets[i]);
+  }
+
+  oonf_class_remove(&_path_class);
+  oonf_class_remove(&_n2_class);
+
+  oonf_class_extension_remove(&_interface_extension);
+  oonf_class_extension_remove(&_link_extension);
+  oonf_class_extension_remove(&_neighbor_extension);
+}
+
+/**
+ * Update the routing MPR set of a domain (RFC 7181, 18.5).
+ * It is based on the incoming link metrics, so the selected MPRs
+ * advertise the best paths towards the local router.
+ * @param domain pointer to NHDP domain
+ * @param neigh neighbor that changed, NULL for whole neighborhood
+ */
+static void
+_cb_update_routing_mpr(struct nhdp_domain *domain,
+    struct nhdp_neighbor *neigh) {
+  struct nhdp_neighbor_domaindata *data;
+  struct _mpr_neighbor *mprdata;
+  struct _mpr_set *set;
+  struct _mpr_n1 *n1, *n1_it;
+  struct nhdp_neighbor *n;
+
+  set = &_routing_sets[domain->index];
+  if (set->failed) {
+    /* start again from scratch */
+    _set_clear(set);
+    neigh = NULL;
+  }
+
+  if (neigh != NULL) {
+    _update_routing_n1(domain, neigh);
+  }
+  else {
+    list_for_each_element(&nhdp_neigh_list, n, _global_node) {
+      _update_routing_n1(domain, n);
+    }
+    _set_dirty_all(set);
+  }
+
+  _set_update(set);
+
+  if (set->failed) {
+    /* out of memory, use every willing neighbor */
+    list_for_each_element(&nhdp_neigh_list, n, _global_node) {
+      data = nhdp_domain_get_neighbordata(domain, n);
+      data->neigh_is_mpr = n->symmetric > 0
+          && data->willingness != RFC5444_WILLINGNESS_NEVER;
+    }
+    return;
+  }
+
+  if (neigh == NULL) {
+    list_for_each_element(&nhdp_neigh_list, n, _global_node) {
+      mprdata = oonf_class_get_extension(&_neighbor_extension, n);
+      nhdp_domain_get_neighbordata(domain, n)->neigh_is_mpr =
+          mprdata->routing[domain->index].selected;
+    }
+  }
+  else {
+    mprdata = oonf_class_get_extension(&_neighbor_extension, neigh);
+    nhdp_domain_get_neighbordata(domain, neigh)->neigh_is_mpr =
+        mprdata->routing[domain->index].selected;
+  }
+
+  list_for_each_element_safe(&set->touched, n1, _touched_node, n1_it) {
+    list_remove(&n1->_touched_node);
+    nhdp_domain_get_neighbordata(domain, n1->neigh)->neigh_is_mpr =
+        n1->selected;
+  }
+
+  OONF_DEBUG(LOG_MPR, "Routing MPRs of domain %u updated: %u two-hop"
+      " addresses", domain->ext, (unsigned)set->n2.count);
+}
+
+/**
+ * Update the flooding MPR sets (RFC 7181, 18.4).
+ * The sets are calculated for each interface independently, based on
+ * the outgoing link metrics of the flooding domain. A neighbor is a
+ * flooding MPR if it has been selected on any interface.
+ * @param domain pointer to NHDP domain of the flooding TLVs,
+ *   NULL to use hopcount
+ * @param neigh neighbor that changed, NULL for whole neighborhood
+ */
+static void
+_cb_update_flooding_mpr(struct nhdp_domain *domain,
+    struct nhdp_neighbor *neigh) {
+  struct nhdp_interface *interf;
+  struct _mpr_set *set;
+  struct _mpr_n1 *n1, *n1_it;
+  struct nhdp_link *lnk;
+  struct nhdp_neighbor *n;
+
+  avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+    set = _get_flooding_set(interf);
+    if (set->failed) {
+      /* start again from scratch */
+      _set_clear(set);
+      neigh = NULL;
+    }
+  }
+
+  if (neigh != NULL) {
+    list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+      _update_flooding_n1(domain, lnk);
+    }
+  }
+  else {
+    list_for_each_element(&nhdp_link_list, lnk, _global_node) {
+      _update_flooding_n1(domain, lnk);
+    }
+    avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+      _set_dirty_all(_get_flooding_set(interf));
+    }
+  }
+
+  avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+    _set_update(_get_flooding_set(interf));
+  }
+
+  /* a neighbor is a flooding MPR if one of its links has been selected */
+  avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+    set = _get_flooding_set(interf);
+    if (set->failed) {
+      continue;
+    }
+
+    list_for_each_element_safe(&set->touched, n1, _touched_node, n1_it) {
+      list_remove(&n1->_touched_node);
+      _update_flooding_result(n1->neigh);
+    }
+
+    OONF_DEBUG(LOG_MPR, "Flooding MPRs of interface %s updated: %u two-hop"
+        " addresses", nhdp_interface_get_name(interf),
+        (unsigned)set->n2.count);
+  }
+
+  if (neigh == NULL) {
+    list_for_each_element(&nhdp_neigh_list, n, _global_node) {
+      _update_flooding_result(n);
+    }
+  }
+  else {
+    _update_flooding_result(neigh);
+  }
+
+  avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+    if (!_get_flooding_set(interf)->failed) {
+      continue;
+    }
+
+    /* out of memory, use every willing neighbor of the interface */
+    list_for_each_element(&interf->_links, lnk, _if_node) {
+      if (lnk->status == NHDP_LINK_SYMMETRIC
+          && lnk->neigh->flooding_willingness != RFC5444_WILLINGNESS_NEVER) {
+        lnk->neigh->neigh_is_flooding_mpr = true;
+      }
+    }
+  }
+}
+
+/**
+ * Update the routing MPR input of one neighbor
+ * @param domain pointer to NHDP domain
+ * @param neigh pointer to NHDP neighbor
+ */
+static void
+_update_routing_n1(struct nhdp_domain *domain, struct nhdp_neighbor *neigh) {
+  struct nhdp_neighbor_domaindata *data;
+  struct _mpr_neighbor *mprdata;
+  struct _mpr_n1 *n1;
+  struct nhdp_link *lnk;
+  struct nhdp_l2hop *l2hop;
+  uint32_t d2;
+
+  data = nhdp_domain_get_neighbordata(domain, neigh);
+  mprdata = oonf_class_get_extension(&_neighbor_extension, neigh);
+  n1 = &mprdata->routing[domain->index];
+
+  if (neigh->symmetric == 0 || data->metric.in >= RFC5444_METRIC_INFINITE) {
+    _n1_deactivate(n1);
+    return;
+  }
+
+  _n1_activate(&_routing_sets[domain->index], n1, neigh, NULL,
+      data->willingness);
+  _n1_begin_update(n1);
+  _n1_add_directs(n1, data->metric.in);
+
+  if (data->willingness != RFC5444_WILLINGNESS_NEVER) {
+    list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+      if (lnk->status != NHDP_LINK_SYMMETRIC) {
+        continue;
+      }
+
+      avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
+        d2 = nhdp_domain_get_l2hopdata(domain, l2hop)->metric.in;
+        if (d2 < RFC5444_METRIC_INFINITE) {
+          _n1_add_path(n1, &l2hop->twohop_addr, data->metric.in + d2, false);
+        }
+      }
+    }
+  }
+  _n1_end_update(n1);
+}
+
+/**
+ * Update the flooding MPR input of one link
+ * @param domain pointer to NHDP domain of the flooding TLVs,
+ *   NULL to use hopcount
+ * @param lnk pointer to NHDP link
+ */
+static void
+_update_flooding_n1(struct nhdp_domain *domain, struct nhdp_link *lnk) {
+  struct _mpr_link *lnkdata;
+  struct _mpr_n1 *n1;
+  struct nhdp_l2hop *l2hop;
+  uint32_t d1, d2;
+
+  lnkdata = oonf_class_get_extension(&_link_extension, lnk);
+  n1 = &lnkdata->flooding;
+
+  d1 = domain == NULL
+      ? 1 : nhdp_domain_get_linkdata(domain, lnk)->metric.out;
+  if (lnk->status != NHDP_LINK_SYMMETRIC || d1 >= RFC5444_METRIC_INFINITE) {
+    _n1_deactivate(n1);
+    return;
+  }
+
+  _n1_activate(_get_flooding_set(lnk->local_if), n1, lnk->neigh, lnk,
+      lnk->neigh->flooding_willingness);
+  _n1_begin_update(n1);
+  _n1_add_directs(n1, d1);
+
+  if (lnk->neigh->flooding_willingness != RFC5444_WILLINGNESS_NEVER) {
+    avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
+      d2 = domain == NULL
+          ? 1 : nhdp_domain_get_l2hopdata(domain, l2hop)->metric.out;
+      if (d2 < RFC5444_METRIC_INFINITE) {
+        _n1_add_path(n1, &l2hop->twohop_addr, d1 + d2, false);
+      }
+    }
+  }
+  _n1_end_update(n1);
+}
+
+/**
+ * Set the flooding MPR flag of a neighbor from the MPR sets
+ * of all its links
+ * @param neigh pointer to NHDP neighbor
+ */
+static void
+_update_flooding_result(struct nhdp_neighbor *neigh) {
+  struct _mpr_link *lnkdata;
+  struct nhdp_link *lnk;
+
+  neigh->neigh_is_flooding_mpr = false;
+  list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+    lnkdata = oonf_class_get_extension(&_link_extension, lnk);
+    if (lnkdata->flooding.selected) {
+      neigh->neigh_is_flooding_mpr = true;
+      return;
+    }
+  }
+}
+
+/**
+ * @param interf pointer to NHDP interface
+ * @return flooding MPR set of the interface
+ */
+static struct _mpr_set *
+_get_flooding_set(struct nhdp_interface *interf) {
+  struct _mpr_interface *ifdata;
+
+  ifdata = oonf_class_get_extension(&_interface_extension, interf);
+  if (!ifdata->flooding.initialized) {
+    _set_init(&ifdata->flooding);
+  }
+  return &ifdata->flooding;
+}
+
+/**
+ * Initialize an empty MPR set
+ * @param set pointer to MPR set
+ */
+static void
+_set_init(struct _mpr_set *set) {
+  avl_init(&set->n2, avl_comp_netaddr, false);
+  list_init_head(&set->n1);
+  list_init_head(&set->dirty);
+  list_init_head(&set->touched);
+  set->initialized = true;
+  set->failed = false;
+}
+
+/**
+ * Remove all neighbors and addresses from a MPR set
+ * @param set pointer to MPR set
+ */
+static void
+_set_clear(struct _mpr_set *set) {
+  struct _mpr_n1 *n1, *n1_it;
+  struct _mpr_n2 *n2, *n2_it;
+
+  list_for_each_element_safe(&set->n1, n1, _node, n1_it) {
+    _n1_deactivate(n1);
+  }
+
+  /* all addresses lost their paths and are dirty now */
+  list_for_each_element_safe(&set->dirty, n2, _dirty_node, n2_it) {
+    list_remove(&n2->_dirty_node);
+    avl_remove(&set->n2, &n2->_node);
+    oonf_class_free(&_n2_class, n2);
+  }
+  set->failed = false;
+}
+
+/**
+ * Repair a MPR set after the paths of some addresses changed.
+ * Only the changed addresses and the neighbors offering paths
+ * to them are checked. Uncovered addresses are covered again with
+ * the heuristic of RFC 7181, Appendix B, afterwards redundant MPRs
+ * are removed, starting with the lowest willingness.
+ * @param set pointer to MPR set
+ */
+static void
+_set_update(struct _mpr_set *set) {
+  struct _mpr_n2 *n2, *n2_it;
+  struct _mpr_n1 *n1;
+  struct _mpr_path *path;
+  int will;
+
+  if (set->failed) {
+    return;
+  }
+
+  /* recalculate best paths and coverage of all changed addresses */
+  list_for_each_element(&set->dirty, n2, _dirty_node) {
+    _n2_update(set, n2);
+  }
+
+  /* apply the willingness of all touched neighbors */
+  list_for_each_element(&set->touched, n1, _touched_node) {
+    if (n1->willingness == RFC5444_WILLINGNESS_ALWAYS) {
+      _set_selected(n1, true);
+    }
+    else if (n1->willingness == RFC5444_WILLINGNESS_NEVER) {
+      _set_selected(n1, false);
+    }
+  }
+
+  /* select neighbors which are the only provider of a best path */
+  list_for_each_element(&set->dirty, n2, _dirty_node) {
+    if (!n2->required || n2->coverage > 0 || n2->providers != 1) {
+      continue;
+    }
+    list_for_each_element(&n2->paths, path, _n2_node) {
+      if (path->best) {
+        _set_selected(path->n1, true);
+        break;
+      }
+    }
+  }
+
+  /* cover the remaining addresses */
+  while ((n1 = _get_best_candidate(set)) != NULL) {
+    _set_selected(n1, true);
+  }
+
+  /* remove redundant MPRs, starting with the lowest willingness */
+  for (will = RFC5444_WILLINGNESS_NEVER + 1;
+      will < RFC5444_WILLINGNESS_ALWAYS; will++) {
+    list_for_each_element(&set->touched, n1, _touched_node) {
+      if (n1->selected && n1->willingness == will && _is_redundant(n1)) {
+        _set_selected(n1, false);
+      }
+    }
+  }
+
+  /* forget addresses without paths */
+  list_for_each_element_safe(&set->dirty, n2, _dirty_node, n2_it) {
+    list_remove(&n2->_dirty_node);
+    if (list_is_empty(&n2->paths)) {
+      avl_remove(&set->n2, &n2->_node);
+      oonf_class_free(&_n2_class, n2);
+    }
+  }
+}
+
+/**
+ * Add a one-hop neighbor to a MPR set if it is not already part of it
+ * @param set pointer to MPR set
+ * @param n1 pointer to one-hop neighbor
+ * @param neigh pointer to NHDP neighbor
+ * @param lnk pointer to NHDP link for flooding MPRs, NULL otherwise
+ * @param willingness willingness of neighbor
+ */
+static void
+_n1_activate(struct _mpr_set *set, struct _mpr_n1 *n1,
+    struct nhdp_neighbor *neigh, struct nhdp_link *lnk, uint8_t willingness) {
+  struct _mpr_path *path;
+
+  if (n1->set == NULL) {
+    n1->set = set;
+    n1->neigh = neigh;
+    n1->lnk = lnk;
+    n1->willingness = willingness;
+    n1->selected = false;
+
+    avl_init(&n1->paths, avl_comp_netaddr, false);
+    avl_init(&n1->directs, avl_comp_netaddr, false);
+    list_add_tail(&set->n1, &n1->_node);
+    _set_touched(set, n1);
+    return;
+  }
+
+  if (n1->willingness != willingness) {
+    n1->willingness = willingness;
+
+    /* the selection of all covered addresses has to be checked again */
+    avl_for_each_element(&n1->paths, path, _n1_node) {
+      _set_dirty(set, path->n2);
+    }
+    _set_touched(set, n1);
+  }
+}
+
+/**
+ * Remove a one-hop neighbor and all its paths from its MPR set
+ * @param n1 pointer to one-hop neighbor
+ */
+static void
+_n1_deactivate(struct _mpr_n1 *n1) {
+  struct _mpr_path *path, *path_it;
+
+  if (n1->set == NULL) {
+    return;
+  }
+
+  avl_for_each_element_safe(&n1->paths, path, _n1_node, path_it) {
+    _remove_path(path);
+  }
+  avl_for_each_element_safe(&n1->directs, path, _n1_node, path_it) {
+    _remove_path(path);
+  }
+
+  if (list_is_node_added(&n1->_touched_node)) {
+    list_remove(&n1->_touched_node);
+  }
+  list_remove(&n1->_node);
+
+  n1->selected = false;
+  n1->set = NULL;
+}
+
+/**
+ * Start to collect the current paths of a one-hop neighbor
+ * @param n1 pointer to one-hop neighbor
+ */
+static void
+_n1_begin_update(struct _mpr_n1 *n1) {
+  struct _mpr_path *path;
+
+  avl_for_each_element(&n1->paths, path, _n1_node) {
+    path->new_cost = RFC5444_METRIC_INFINITE_PATH;
+  }
+  avl_for_each_element(&n1->directs, path, _n1_node) {
+    path->new_cost = RFC5444_METRIC_INFINITE_PATH;
+  }
+}
+
+/**
+ * Add the current addresses of a one-hop neighbor as direct paths
+ * @param n1 pointer to one-hop neighbor
+ * @param d1 cost of the direct link
+ */
+static void
+_n1_add_directs(struct _mpr_n1 *n1, uint32_t d1) {
+  struct nhdp_naddr *naddr;
+
+  avl_for_each_element(&n1->neigh->_neigh_addresses, naddr, _neigh_node) {
+    if (!oonf_timer_is_active(&naddr->_lost_vtime)) {
+      _n1_add_path(n1, &naddr->neigh_addr, d1, true);
+    }
+  }
+}
+
+/**
+ * Add a current path of a one-hop neighbor. If the neighbor has more
+ * than one path to the same address, the best one is used.
+ * @param n1 pointer to one-hop neighbor
+ * @param addr address reachable through the neighbor
+ * @param cost total cost of the path
+ * @param direct true if the address belongs to the neighbor itself
+ */
+static void
+_n1_add_path(struct _mpr_n1 *n1,
+    const struct netaddr *addr, uint32_t cost, bool direct) {
+  struct avl_tree *tree;
+  struct _mpr_path *path;
+  struct _mpr_n2 *n2;
+
+  tree = direct ? &n1->directs : &n1->paths;
+
+  path = avl_find_element(tree, addr, path, _n1_node);
+  if (path != NULL) {
+    if (path->new_cost > cost) {
+      path->new_cost = cost;
+    }
+    return;
+  }
+
+  n2 = avl_find_element(&n1->set->n2, addr, n2, _node);
+  if (n2 == NULL) {
+    n2 = oonf_class_malloc(&_n2_class);
+    if (n2 == NULL) {
+      OONF_WARN(LOG_MPR, "Out of memory for MPR calculation");
+      n1->set->failed = true;
+      return;
+    }
+
+    memcpy(&n2->addr, addr, sizeof(*addr));
+    n2->_node.key = &n2->addr;
+    avl_insert(&n1->set->n2, &n2->_node);
+
+    list_init_head(&n2->paths);
+    _set_dirty(n1->set, n2);
+  }
+
+  path = oonf_class_malloc(&_path_class);
+  if (path == NULL) {
+    OONF_WARN(LOG_MPR, "Out of memory for MPR calculation");
+    n1->set->failed = true;
+    return;
+  }
+
+  path->n1 = n1;
+  path->n2 = n2;
+  path->direct = direct;
+  path->cost = RFC5444_METRIC_INFINITE_PATH;
+  path->new_cost = cost;
+
+  path->_n1_node.key = &n2->addr;
+  avl_insert(tree, &path->_n1_node);
+  list_add_tail(&n2->paths, &path->_n2_node);
+}
+
+/**
+ * Apply the paths collected since _n1_begin_update(). Only addresses
+ * whose paths really changed are marked for the next MPR update.
+ * @param n1 pointer to one-hop neighbor
+ */
+static void
+_n1_end_update(struct _mpr_n1 *n1) {
+  struct _mpr_path *path, *path_it;
+
+  avl_for_each_element_safe(&n1->paths, path, _n1_node, path_it) {
+    if (path->new_cost == RFC5444_METRIC_INFINITE_PATH) {
+      _remove_path(path);
+    }
+    else if (path->new_cost != path->cost) {
+      path->cost = path->new_cost;
+      _set_dirty(n1->set, path->n2);
+    }
+  }
+  avl_for_each_element_safe(&n1->directs, path, _n1_node, path_it) {
+    if (path->new_cost == RFC5444_METRIC_INFINITE_PATH) {
+      _remove_path(path);
+    }
+    else if (path->new_cost != path->cost) {
+      path->cost = path->new_cost;
+      _set_dirty(n1->set, path->n2);
+    }
+  }
+}
+
+/**
+ * Recalculate the best paths of an address and update the number
+ * of providers and the coverage of the address
+ * @param set pointer to MPR set
+ * @param n2 pointer to address
+ */
+static void
+_n2_update(struct _mpr_set *set, struct _mpr_n2 *n2) {
+  struct _mpr_path *path;
+  uint32_t direct;
+  bool best;
+
+  n2->d = RFC5444_METRIC_INFINITE_PATH;
+  direct = RFC5444_METRIC_INFINITE_PATH;
+
+  list_for_each_element(&n2->paths, path, _n2_node) {
+    if (path->direct) {
+      if (direct > path->cost) {
+        direct = path->cost;
+      }
+    }
+    else if (n2->d > path->cost) {
+      n2->d = path->cost;
+    }
+  }
+
+  if (nhdp_interface_addr_global_get(&n2->addr) != NULL) {
+    /* never cover our own addresses */
+    direct = 0;
+  }
+
+  /* addresses with a direct link as good as all two-hop paths need no MPR */
+  n2->required = n2->d < direct;
+
+  list_for_each_element(&n2->paths, path, _n2_node) {
+    _set_touched(set, path->n1);
+
+    best = !path->direct && n2->required && path->cost == n2->d;
+    if (best == path->best) {
+      continue;
+    }
+
+    path->best = best;
+    if (best) {
+      n2->providers++;
+      if (path->n1->selected) {
+        n2->coverage++;
+      }
+    }
+    else {
+      n2->providers--;
+      if (path->n1->selected) {
+        n2->coverage--;
+      }
+    }
+  }
+}
+
+/**
+ * Mark an address for the next MPR set update
+ * @param set pointer to MPR set
+ * @param n2 pointer to address
+ */
+static void
+_set_dirty(struct _mpr_set *set, struct _mpr_n2 *n2) {
+  if (!list_is_node_added(&n2->_dirty_node)) {
+    list_add_tail(&set->dirty, &n2->_dirty_node);
+  }
+}
+
+/**
+ * Mark all addresses of a MPR set for the next update
+ * @param set pointer to MPR set
+ */
+static void
+_set_dirty_all(struct _mpr_set *set) {
+  struct _mpr_n2 *n2;
+
+  avl_for_each_element(&set->n2, n2, _node) {
+    _set_dirty(set, n2);
+  }
+}
+
+/**
+ * Mark a one-hop neighbor whose MPR setting has to be checked
+ * @param set pointer to MPR set
+ * @param n1 pointer to one-hop neighbor
+ */
+static void
+_set_touched(struct _mpr_set *set, struct _mpr_n1 *n1) {
+  if (!list_is_node_added(&n1->_touched_node)) {
+    list_add_tail(&set->touched, &n1->_touched_node);
+  }
+}
+
+/**
+ * Add or remove a one-hop neighbor from the MPR set. Adding a MPR
+ * might make the other providers of its addresses redundant, so
+ * they are checked again.
+ * @param n1 pointer to one-hop neighbor
+ * @param selected true to add the neighbor, false to remove it
+ */
+static void
+_set_selected(struct _mpr_n1 *n1, bool selected) {
+  struct _mpr_path *path, *other;
+
+  if (n1->selected == selected) {
+    return;
+  }
+  n1->selected = selected;
+
+  avl_for_each_element(&n1->paths, path, _n1_node) {
+    if (!path->best) {
+      continue;
+    }
+
+    if (!selected) {
+      path->n2->coverage--;
+      continue;
+    }
+
+    path->n2->coverage++;
+    list_for_each_element(&path->n2->paths, other, _n2_node) {
+      if (other->best && other->n1->selected) {
+        _set_touched(n1->set, other->n1);
+      }
+    }
+  }
+}
+
+/**
+ * Remove a path from its one-hop neighbor and address
+ * @param path pointer to path
+ */
+static void
+_remove_path(struct _mpr_path *path) {
+  struct _mpr_n1 *n1;
+  struct _mpr_n2 *n2;
+
+  n1 = path->n1;
+  n2 = path->n2;
+
+  if (path->best) {
+    n2->providers--;
+    if (n1->selected) {
+      n2->coverage--;
+    }
+  }
+
+  avl_remove(path->direct ? &n1->directs : &n1->paths, &path->_n1_node);
+  list_remove(&path->_n2_node);
+  _set_dirty(n1->set, n2);
+  _set_touched(n1->set, n1);
+
+  oonf_class_free(&_path_class, path);
+}
+
+/**
+ * Find the neighbor that should cover the next uncovered address,
+ * preferring the highest willingness, then the largest number of
+ * uncovered addresses and then the largest number of best paths
+ * @param set pointer to MPR set
+ * @return one-hop neighbor, NULL if all required addresses are covered
+ */
+static struct _mpr_n1 *
+_get_best_candidate(struct _mpr_set *set) {
+  struct _mpr_n1 *best;
+  struct _mpr_n2 *n2;
+  struct _mpr_path *path;
+  size_t r, d, best_r, best_d;
+
+  best = NULL;
+  best_r = 0;
+  best_d = 0;
+
+  /* only changed addresses can have lost their coverage */
+  list_for_each_element(&set->dirty, n2, _dirty_node) {
+    if (!n2->required || n2->coverage > 0) {
+      continue;
+    }
+
+    list_for_each_element(&n2->paths, path, _n2_node) {
+      if (!path->best || path->n1 == best) {
+        continue;
+      }
+
+      r = _count_paths(path->n1, true);
+      d = _count_paths(path->n1, false);
+
+      if (best == NULL
+          || path->n1->willingness > best->willingness
+          || (path->n1->willingness == best->willingness
+              && (r > best_r || (r == best_r && d > best_d)))) {
+        best = path->n1;
+        best_r = r;
+        best_d = d;
+      }
+    }
+  }
+  return best;
+}
+
+/**
+ * Count the required addresses a one-hop neighbor offers a best path to
+ * @param n1 pointer to one-hop neighbor
+ * @param only_uncovered true to count only addresses not covered yet
+ * @return number of addresses
+ */
+static size_t
+_count_paths(struct _mpr_n1 *n1, bool only_uncovered) {
+  struct _mpr_path *path;
+  size_t count;
+
+  count = 0;
+  avl_for_each_element(&n1->paths, path, _n1_node) {
+    if (path->best && (!only_uncovered || path->n2->coverage == 0)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @param n1 pointer to selected one-hop neighbor
+ * @return true if every address covered by the neighbor is covered
+ *   by another MPR too
+ */
+static bool
+_is_redundant(struct _mpr_n1 *n1) {
+  struct _mpr_path *path;
+
+  avl_for_each_element(&n1->paths, path, _n1_node) {
+    if (path->best && path->n2->coverage < 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Callback triggered when a NHDP neighbor is removed
+ * @param ptr pointer to NHDP neighbor
+ */
+static void
+_cb_neighbor_removed(void *ptr) {
+  struct _mpr_neighbor *mprdata;
+  size_t i;
+
+  mprdata = oonf_class_get_extension(&_neighbor_extension, ptr);
+  for (i = 0; i < NHDP_MAXIMUM_DOMAINS; i++) {
+    _n1_deactivate(&mprdata->routing[i]);
+  }
+}
+
+/**
+ * Callback triggered when a NHDP link is removed
+ * @param ptr pointer to NHDP link
+ */
+static void
+_cb_link_removed(void *ptr) {
+  struct _mpr_link *lnkdata;
+
+  lnkdata = oonf_class_get_extension(&_link_extension, ptr);
+  _n1_deactivate(&lnkdata->flooding);
+}
+
+/**
+ * Callback triggered when a NHDP interface is removed
+ * @param ptr pointer to NHDP interface
+ */
+static void
+_cb_interface_removed(void *ptr) {
+  struct _mpr_interface *ifdata;
+
+  ifdata = oonf_class_get_extension(&_interface_extension, ptr);
+  if (ifdata->flooding.initialized) {
+    _set_clear(&ifdata->flooding);
+  }
+}
+
+/**
+ * Callback triggered when plugin configuration changes
+ */
+static void
+_cb_cfg_changed(void) {
+  struct _config cfg;
+
+  memset(&cfg, 0, sizeof(cfg));
+  if (cfg_schema_tobin(&cfg, _mpr_section.post,
+      _mpr_entries, ARRAYSIZE(_mpr_entries))) {
+    OONF_WARN(LOG_MPR, "Cannot convert plugin configuration.");
+    return;
+  }
+
+  _routing_mpr.willingness = cfg.willingness;
+  _flooding_mpr.willingness = cfg.willingness;
+}
@@ -161,7 +161,7 @@ static enum rfc5444_result
 _cb_message_start_callback(struct rfc5444_reader_tlvblock_context *context) {
   struct nhdp_interface *interf;
 
-  interf = nhdp_interface_get(_protocol->input_interface->name);
+  interf = nhdp_interface_get_input();
   assert(interf);
 
   /* check address length */
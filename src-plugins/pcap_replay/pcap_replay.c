@@ -0,0 +1,837 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/common_types.h"
+#include "common/autobuf.h"
+#include "common/netaddr.h"
+#include "rfc5444/rfc5444_reader.h"
+#include "core/oonf_logging.h"
+#include "core/oonf_plugins.h"
+#include "subsystems/oonf_class.h"
+#include "subsystems/oonf_rfc5444.h"
+#include "subsystems/oonf_telnet.h"
+
+#include "nhdp/nhdp_db.h"
+#include "nhdp/nhdp_interfaces.h"
+
+#include "olsrv2/olsrv2_tc.h"
+
+#include "pcap_replay/pcap_replay.h"
+
+/* definitions */
+enum {
+  /* UDP port of RFC5444 traffic, see RFC 5498 */
+  PCAP_MANET_PORT = 269,
+
+  /* pcap link layer types */
+  PCAP_LINKTYPE_NULL = 0,
+  PCAP_LINKTYPE_ETHERNET = 1,
+  PCAP_LINKTYPE_RAW = 101,
+  PCAP_LINKTYPE_LINUX_SLL = 113,
+  PCAP_LINKTYPE_LINUX_SLL2 = 276,
+
+  /* size of pcap file and record header */
+  PCAP_FILE_HEADER_SIZE = 24,
+  PCAP_RECORD_HEADER_SIZE = 16,
+};
+
+/* parts of the packet processing the replay time is split into */
+enum _replay_stage {
+  STAGE_VALIDATORS,
+  STAGE_LINK_QUALITY,
+  STAGE_READERS,
+  STAGE_PLUGINS,
+  STAGE_OTHER,
+
+  STAGE_COUNT,
+  STAGE_NONE = STAGE_COUNT,
+};
+
+/* database objects counted during a replay */
+enum _replay_object {
+  OBJECT_LINK,
+  OBJECT_LINK_ADDRESS,
+  OBJECT_LINK_2HOP,
+  OBJECT_NEIGHBOR,
+  OBJECT_NEIGHBOR_ADDRESS,
+  OBJECT_TC_NODE,
+  OBJECT_TC_EDGE,
+  OBJECT_ATTACHED,
+  OBJECT_ENDPOINT,
+
+  OBJECT_COUNT,
+};
+
+/* statistics of a pcap replay */
+struct _replay_stats {
+  uint64_t packets;
+  uint64_t skipped;
+  uint64_t messages;
+  uint64_t bytes;
+
+  /* time in nanoseconds */
+  uint64_t total_time;
+  uint64_t stage_time[STAGE_COUNT];
+
+  uint64_t allocations[OBJECT_COUNT];
+};
+
+/* UDP payload of a captured RFC5444 packet */
+struct _captured_packet {
+  struct netaddr src;
+  uint16_t src_port;
+  bool multicast;
+
+  uint8_t *payload;
+  size_t length;
+};
+
+/* prototypes */
+static int _init(void);
+static void _cleanup(void);
+
+static int _replay_file(struct autobuf *out,
+    struct nhdp_interface *interf, const char *file);
+static void _replay_packet(struct nhdp_interface *interf,
+    struct _captured_packet *pkt);
+static bool _parse_record(struct _captured_packet *pkt,
+    uint32_t linktype, uint8_t *data, size_t len);
+static bool _parse_ip(struct _captured_packet *pkt, uint8_t *data, size_t len);
+static void _print_stats(struct autobuf *out);
+
+static uint16_t _get_u16(const uint8_t *ptr);
+static uint32_t _get_u32(const uint8_t *ptr, bool swapped);
+static uint64_t _get_time(void);
+static void _set_stage(enum _replay_stage stage);
+
+static enum rfc5444_result _cb_probe_validators(
+    struct rfc5444_reader_tlvblock_context *context);
+static enum rfc5444_result _cb_probe_link_quality(
+    struct rfc5444_reader_tlvblock_context *context);
+static enum rfc5444_result _cb_probe_readers(
+    struct rfc5444_reader_tlvblock_context *context);
+static enum rfc5444_result _cb_probe_plugins(
+    struct rfc5444_reader_tlvblock_context *context);
+static enum rfc5444_result _cb_probe_other(
+    struct rfc5444_reader_tlvblock_context *context);
+
+static void _count_allocation(enum _replay_object);
+static void _cb_link_added(void *);
+static void _cb_laddr_added(void *);
+static void _cb_l2hop_added(void *);
+static void _cb_neighbor_added(void *);
+static void _cb_naddr_added(void *);
+static void _cb_tc_node_added(void *);
+static void _cb_tc_edge_added(void *);
+static void _cb_attached_added(void *);
+static void _cb_endpoint_added(void *);
+
+static enum oonf_telnet_result _cb_telnet_replay(struct oonf_telnet_data *con);
+
+/* plugin declaration */
+struct oonf_subsystem olsrv2_pcap_replay_subsystem = {
+  .name = OONF_PLUGIN_GET_NAME(),
+  .descr = "OLSRv2 pcap replay benchmark plugin",
+  .author = "Henning Rogge",
+
+  .init = _init,
+  .cleanup = _cleanup,
+};
+DECLARE_OONF_PLUGIN(olsrv2_pcap_replay_subsystem);
+
+/*
+ * probe consumers around the consumers of NHDP, OLSRv2 and the plugins,
+ * the time between two probes is accounted to the stage in between
+ */
+static struct rfc5444_reader_tlvblock_consumer _probes[] = {
+  {
+    /* olsrv2 duplicate filter uses VALIDATOR_PRIORITY-1 */
+    .order = RFC5444_VALIDATOR_PRIORITY - 2,
+    .default_msg_consumer = true,
+    .start_callback = _cb_probe_validators,
+  },
+  {
+    .order = RFC5444_MAIN_PARSER_PRIORITY - 1,
+    .default_msg_consumer = true,
+    .start_callback = _cb_probe_readers,
+  },
+  {
+    /* nhdp reader uses MAIN_PARSER_PRIORITY and MAIN_PARSER_PRIORITY+1 */
+    .order = RFC5444_MAIN_PARSER_PRIORITY + 2,
+    .default_msg_consumer = true,
+    .start_callback = _cb_probe_plugins,
+  },
+  {
+    .order = RFC5444_PLUGIN_PARSER_PRIORITY + 1024,
+    .default_msg_consumer = true,
+    .start_callback = _cb_probe_other,
+  },
+};
+
+static struct rfc5444_reader_tlvblock_consumer _packet_probes[] = {
+  {
+    .order = RFC5444_LQ_PARSER_PRIORITY - 1,
+    .start_callback = _cb_probe_link_quality,
+  },
+  {
+    .order = RFC5444_LQ_PARSER_PRIORITY + 1,
+    .start_callback = _cb_probe_other,
+  },
+};
+
+static const char *_stage_names[STAGE_COUNT] = {
+  [STAGE_VALIDATORS] = "validators",
+  [STAGE_LINK_QUALITY] = "link quality",
+  [STAGE_READERS] = "nhdp/olsrv2 readers",
+  [STAGE_PLUGINS] = "plugin consumers",
+  [STAGE_OTHER] = "rfc5444 parser and other",
+};
+
+/* listeners to count database objects allocated during a replay */
+static struct oonf_class_extension _alloc_listeners[OBJECT_COUNT] = {
+  [OBJECT_LINK] = {
+    .ext_name = "pcap replay",
+    .class_name = NHDP_CLASS_LINK,
+    .cb_add = _cb_link_added,
+  },
+  [OBJECT_LINK_ADDRESS] = {
+    .ext_name = "pcap replay",
+    .class_name = NHDP_CLASS_LINK_ADDRESS,
+    .cb_add = _cb_laddr_added,
+  },
+  [OBJECT_LINK_2HOP] = {
+    .ext_name = "pcap replay",
+    .class_name = NHDP_CLASS_LINK_2HOP,
+    .cb_add = _cb_l2hop_added,
+  },
+  [OBJECT_NEIGHBOR] = {
+    .ext_name = "pcap replay",
+    .class_name = NHDP_CLASS_NEIGHBOR,
+    .cb_add = _cb_neighbor_added,
+  },
+  [OBJECT_NEIGHBOR_ADDRESS] = {
+    .ext_name = "pcap replay",
+    .class_name = NHDP_CLASS_NEIGHBOR_ADDRESS,
+    .cb_add = _cb_naddr_added,
+  },
+  [OBJECT_TC_NODE] = {
+    .ext_name = "pcap replay",
+    .class_name = OLSRV2_CLASS_TC_NODE,
+    .cb_add = _cb_tc_node_added,
+  },
+  [OBJECT_TC_EDGE] = {
+    .ext_name = "pcap replay",
+    .class_name = OLSRV2_CLASS_TC_EDGE,
+    .cb_add = _cb_tc_edge_added,
+  },
+  [OBJECT_ATTACHED] = {
+    .ext_name = "pcap replay",
+    .class_name = OLSRV2_CLASS_ATTACHED,
+    .cb_add = _cb_attached_added,
+  },
+  [OBJECT_ENDPOINT] = {
+    .ext_name = "pcap replay",
+    .class_name = OLSRV2_CLASS_ENDPOINT,
+    .cb_add = _cb_endpoint_added,
+  },
+};
+
+/* telnet command */
+static struct oonf_telnet_command _cmds[] = {
+    TELNET_CMD("pcap_replay", _cb_telnet_replay,
+        "\"pcap_replay <interface> <file>\": feeds all RFC5444 packets of a"
+        " pcap file into the reader as if they were received on"
+        " a NHDP interface and shows packet rate, time per consumer"
+        " stage and the number of allocated database objects\n"),
+};
+
+static struct oonf_rfc5444_protocol *_protocol = NULL;
+
+/* state of the running replay */
+static bool _replay_active = false;
+static struct _replay_stats _stats;
+static enum _replay_stage _current_stage = STAGE_NONE;
+static uint64_t _stage_start = 0;
+
+/**
+ * Initialize plugin
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_init(void) {
+  size_t i;
+
+  _protocol = oonf_rfc5444_add_protocol(RFC5444_PROTOCOL, true);
+  if (_protocol == NULL) {
+    return -1;
+  }
+
+  for (i=0; i<ARRAYSIZE(_alloc_listeners); i++) {
+    if (oonf_class_extension_add(&_alloc_listeners[i])) {
+      while (i > 0) {
+        oonf_class_extension_remove(&_alloc_listeners[--i]);
+      }
+      oonf_rfc5444_remove_protocol(_protocol);
+      return -1;
+    }
+  }
+
+  for (i=0; i<ARRAYSIZE(_probes); i++) {
+    rfc5444_reader_add_message_consumer(
+        &_protocol->reader, &_probes[i], NULL, 0);
+  }
+  for (i=0; i<ARRAYSIZE(_packet_probes); i++) {
+    rfc5444_reader_add_packet_consumer(
+        &_protocol->reader, &_packet_probes[i], NULL, 0);
+  }
+
+  for (i=0; i<ARRAYSIZE(_cmds); i++) {
+    oonf_telnet_add(&_cmds[i]);
+  }
+  return 0;
+}
+
+/**
+ * Cleanup plugin
+ */
+static void
+_cleanup(void) {
+  size_t i;
+
+  for (i=0; i<ARRAYSIZE(_cmds); i++) {
+    oonf_telnet_remove(&_cmds[i]);
+  }
+
+  for (i=0; i<ARRAYSIZE(_packet_probes); i++) {
+    rfc5444_reader_remove_packet_consumer(
+        &_protocol->reader, &_packet_probes[i]);
+  }
+  for (i=0; i<ARRAYSIZE(_probes); i++) {
+    rfc5444_reader_remove_message_consumer(
+        &_protocol->reader, &_probes[i]);
+  }
+
+  for (i=0; i<ARRAYSIZE(_alloc_listeners); i++) {
+    oonf_class_extension_remove(&_alloc_listeners[i]);
+  }
+
+  oonf_rfc5444_remove_protocol(_protocol);
+  _protocol = NULL;
+}
+
+/**
+ * Replay all RFC5444 packets of a pcap file
+ * @param out output buffer for error messages
+ * @param interf NHDP interface the packets are received on
+ * @param file name of pcap file
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_replay_file(struct autobuf *out,
+    struct nhdp_interface *interf, const char *file) {
+  struct _captured_packet pkt;
+  struct stat st;
+  uint8_t *data;
+  size_t offset, len;
+  uint32_t magic, linktype;
+  bool swapped;
+  int fd;
+
+  fd = open(file, O_RDONLY);
+  if (fd < 0) {
+    abuf_appendf(out, "Cannot open pcap file %s: %s (%d)\n",
+        file, strerror(errno), errno);
+    return -1;
+  }
+
+  if (fstat(fd, &st) || st.st_size < PCAP_FILE_HEADER_SIZE) {
+    abuf_appendf(out, "File %s is no pcap file\n", file);
+    close(fd);
+    return -1;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    abuf_appendf(out, "Cannot map pcap file %s: %s (%d)\n",
+        file, strerror(errno), errno);
+    return -1;
+  }
+
+  /* nanosecond pcap files only differ in the timestamps */
+  magic = _get_u32(data, false);
+  if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+    swapped = false;
+  }
+  else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
+    swapped = true;
+  }
+  else {
+    abuf_appendf(out, "File %s is no pcap file\n", file);
+    munmap(data, st.st_size);
+    return -1;
+  }
+  linktype = _get_u32(data + 20, swapped);
+
+  memset(&_stats, 0, sizeof(_stats));
+  _replay_active = true;
+
+  for (offset = PCAP_FILE_HEADER_SIZE;
+      offset + PCAP_RECORD_HEADER_SIZE <= (size_t)st.st_size;
+      offset += PCAP_RECORD_HEADER_SIZE + len) {
+    len = _get_u32(data + offset + 8, swapped);
+    if (offset + PCAP_RECORD_HEADER_SIZE + len > (size_t)st.st_size) {
+      /* truncated capture */
+      break;
+    }
+
+    if (_parse_record(&pkt, linktype,
+        data + offset + PCAP_RECORD_HEADER_SIZE, len)) {
+      _replay_packet(interf, &pkt);
+    }
+    else {
+      _stats.skipped++;
+    }
+  }
+
+  _replay_active = false;
+  munmap(data, st.st_size);
+  return 0;
+}
+
+/**
+ * Feed a single captured packet into the RFC5444 reader
+ * @param interf NHDP interface the packet is received on
+ * @param pkt captured packet
+ */
+static void
+_replay_packet(struct nhdp_interface *interf, struct _captured_packet *pkt) {
+  union netaddr_socket sock;
+  uint64_t start;
+
+  netaddr_socket_init(&sock, &pkt->src, pkt->src_port, 0);
+
+  _protocol->input_address = &pkt->src;
+  _protocol->input_socket = &sock;
+  _protocol->input_interface = interf->rfc5444_if.interface;
+  _protocol->input_is_multicast = pkt->multicast;
+
+  start = _get_time();
+  _current_stage = STAGE_OTHER;
+  _stage_start = start;
+
+  rfc5444_reader_handle_packet(&_protocol->reader, pkt->payload, pkt->length);
+
+  _set_stage(STAGE_NONE);
+  _stats.total_time += _get_time() - start;
+
+  _protocol->input_address = NULL;
+  _protocol->input_socket = NULL;
+  _protocol->input_interface = NULL;
+
+  _stats.packets++;
+  _stats.bytes += pkt->length;
+}
+
+/**
+ * Extract the RFC5444 payload of a pcap record
+ * @param pkt captured packet
+ * @param linktype link layer type of pcap file
+ * @param data pointer to record data
+ * @param len length of record data
+ * @return true if the record contains a RFC5444 packet
+ */
+static bool
+_parse_record(struct _captured_packet *pkt,
+    uint32_t linktype, uint8_t *data, size_t len) {
+  size_t hdr_len;
+  uint16_t ethertype;
+
+  switch (linktype) {
+    case PCAP_LINKTYPE_NULL:
+      hdr_len = 4;
+      break;
+    case PCAP_LINKTYPE_RAW:
+      hdr_len = 0;
+      break;
+    case PCAP_LINKTYPE_ETHERNET:
+      if (len < 14) {
+        return false;
+      }
+      hdr_len = 14;
+      ethertype = _get_u16(data + 12);
+      if (ethertype == 0x8100 && len >= 18) {
+        /* skip VLAN tag */
+        hdr_len = 18;
+        ethertype = _get_u16(data + 16);
+      }
+      if (ethertype != 0x0800 && ethertype != 0x86dd) {
+        return false;
+      }
+      break;
+    case PCAP_LINKTYPE_LINUX_SLL:
+      hdr_len = 16;
+      break;
+    case PCAP_LINKTYPE_LINUX_SLL2:
+      hdr_len = 20;
+      break;
+    default:
+      return false;
+  }
+
+  if (len <= hdr_len) {
+    return false;
+  }
+  return _parse_ip(pkt, data + hdr_len, len - hdr_len);
+}
+
+/**
+ * Extract the RFC5444 payload of an IPv4/IPv6 UDP packet
+ * @param pkt captured packet
+ * @param data pointer to IP header
+ * @param len length of IP packet
+ * @return true if the packet contains a RFC5444 packet
+ */
+static bool
+_parse_ip(struct _captured_packet *pkt, uint8_t *data, size_t len) {
+  size_t hdr_len, udp_len;
+  uint8_t next_header;
+
+  if ((data[0] >> 4) == 4) {
+    hdr_len = (data[0] & 0x0f) * 4;
+    if (len < 20 || hdr_len < 20 || len < hdr_len + 8
+        || data[9] != IPPROTO_UDP) {
+      return false;
+    }
+    if (_get_u16(data + 6) & 0x3fff) {
+      /* ignore fragments */
+      return false;
+    }
+
+    netaddr_from_binary(&pkt->src, data + 12, 4, AF_INET);
+    pkt->multicast = data[16] >= 224 && data[16] < 240;
+  }
+  else if ((data[0] >> 4) == 6) {
+    if (len < 48) {
+      return false;
+    }
+
+    /* skip hop-by-hop, routing and destination option headers */
+    next_header = data[6];
+    hdr_len = 40;
+    while (next_header == 0 || next_header == 43 || next_header == 60) {
+      if (len < hdr_len + 8) {
+        return false;
+      }
+      next_header = data[hdr_len];
+      hdr_len += (data[hdr_len + 1] + 1) * 8;
+    }
+    if (next_header != IPPROTO_UDP || len < hdr_len + 8) {
+      return false;
+    }
+
+    netaddr_from_binary(&pkt->src, data + 8, 16, AF_INET6);
+    pkt->multicast = data[24] == 0xff;
+  }
+  else {
+    return false;
+  }
+
+  data += hdr_len;
+  len -= hdr_len;
+
+  if (_get_u16(data + 2) != PCAP_MANET_PORT) {
+    return false;
+  }
+
+  udp_len = _get_u16(data + 4);
+  if (udp_len < 8 || udp_len > len) {
+    /* truncated capture */
+    return false;
+  }
+
+  pkt->src_port = _get_u16(data);
+  pkt->payload = data + 8;
+  pkt->length = udp_len - 8;
+  return pkt->length > 0;
+}
+
+/**
+ * Handle the "pcap_replay" telnet command
+ * @param con telnet data connection
+ * @return telnet result
+ */
+static enum oonf_telnet_result
+_cb_telnet_replay(struct oonf_telnet_data *con) {
+  struct nhdp_interface *interf;
+  char ifname[IF_NAMESIZE];
+  const char *file;
+  size_t len;
+
+  if (con->parameter == NULL
+      || (file = strchr(con->parameter, ' ')) == NULL) {
+    abuf_puts(con->out, "Usage: pcap_replay <interface> <file>\n");
+    return TELNET_RESULT_ACTIVE;
+  }
+
+  len = file - con->parameter;
+  if (len >= sizeof(ifname)) {
+    len = sizeof(ifname) - 1;
+  }
+  memcpy(ifname, con->parameter, len);
+  ifname[len] = 0;
+
+  /* skip additional spaces */
+  while (*file == ' ') {
+    file++;
+  }
+
+  interf = nhdp_interface_get(ifname);
+  if (interf == NULL || interf->rfc5444_if.interface == NULL) {
+    abuf_appendf(con->out, "Unknown NHDP interface: %s\n", ifname);
+    return TELNET_RESULT_ACTIVE;
+  }
+
+  if (_replay_file(con->out, interf, file) == 0) {
+    _print_stats(con->out);
+  }
+  return TELNET_RESULT_ACTIVE;
+}
+
+/**
+ * Print the statistics of the last replay
+ * @param out output buffer
+ */
+static void
+_print_stats(struct autobuf *out) {
+  uint64_t time;
+  size_t i;
+
+  /* avoid division by zero, time is in nanoseconds */
+  time = _stats.total_time;
+  if (time == 0) {
+    time = 1;
+  }
+
+  abuf_appendf(out, "Packets: %"PRIu64" (%"PRIu64" skipped)"
+      " Messages: %"PRIu64" Bytes: %"PRIu64"\n",
+      _stats.packets, _stats.skipped, _stats.messages, _stats.bytes);
+  abuf_appendf(out, "Time: %"PRIu64" us, %"PRIu64" packets/s,"
+      " %"PRIu64" messages/s\n",
+      _stats.total_time / 1000,
+      _stats.packets * 1000000000 / time,
+      _stats.messages * 1000000000 / time);
+
+  for (i=0; i<STAGE_COUNT; i++) {
+    abuf_appendf(out, "Stage '%s': %"PRIu64" us (%"PRIu64"%%)\n",
+        _stage_names[i], _stats.stage_time[i] / 1000,
+        _stats.stage_time[i] * 100 / time);
+  }
+
+  for (i=0; i<OBJECT_COUNT; i++) {
+    abuf_appendf(out, "Allocated '%s': %"PRIu64"\n",
+        _alloc_listeners[i].class_name, _stats.allocations[i]);
+  }
+}
+
+/**
+ * @param ptr pointer to big endian 16 bit value
+ * @return host byte order value
+ */
+static uint16_t
+_get_u16(const uint8_t *ptr) {
+  return (ptr[0] << 8) | ptr[1];
+}
+
+/**
+ * @param ptr pointer to 32 bit value in byte order of pcap writer
+ * @param swapped true if pcap file has the other byte order than
+ *   the one the magic number is compared with
+ * @return host byte order value
+ */
+static uint32_t
+_get_u32(const uint8_t *ptr, bool swapped) {
+  uint32_t value;
+
+  memcpy(&value, ptr, sizeof(value));
+  if (swapped) {
+    value = __builtin_bswap32(value);
+  }
+  return value;
+}
+
+/**
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t
+_get_time(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Account the time since the last probe to the current stage
+ * and switch to a new one
+ * @param stage new stage
+ */
+static void
+_set_stage(enum _replay_stage stage) {
+  uint64_t now;
+
+  if (!_replay_active) {
+    return;
+  }
+
+  now = _get_time();
+  if (_current_stage != STAGE_NONE) {
+    _stats.stage_time[_current_stage] += now - _stage_start;
+  }
+  _current_stage = stage;
+  _stage_start = now;
+}
+
+static enum rfc5444_result
+_cb_probe_validators(
+    struct rfc5444_reader_tlvblock_context *context __attribute__((unused))) {
+  if (_replay_active) {
+    _stats.messages++;
+  }
+  _set_stage(STAGE_VALIDATORS);
+  return RFC5444_OKAY;
+}
+
+static enum rfc5444_result
+_cb_probe_link_quality(
+    struct rfc5444_reader_tlvblock_context *context __attribute__((unused))) {
+  _set_stage(STAGE_LINK_QUALITY);
+  return RFC5444_OKAY;
+}
+
+static enum rfc5444_result
+_cb_probe_readers(
+    struct rfc5444_reader_tlvblock_context *context __attribute__((unused))) {
+  _set_stage(STAGE_READERS);
+  return RFC5444_OKAY;
+}
+
+static enum rfc5444_result
+_cb_probe_plugins(
+    struct rfc5444_reader_tlvblock_context *context __attribute__((unused))) {
+  _set_stage(STAGE_PLUGINS);
+  return RFC5444_OKAY;
+}
+
+static enum rfc5444_result
+_cb_probe_other(
+    struct rfc5444_reader_tlvblock_context *context __attribute__((unused))) {
+  _set_stage(STAGE_OTHER);
+  return RFC5444_OKAY;
+}
+
+/**
+ * Count a database object allocated during a replay
+ * @param type type of object
+ */
+static void
+_count_allocation(enum _replay_object type) {
+  if (_replay_active) {
+    _stats.allocations[type]++;
+  }
+}
+
+static void
+_cb_link_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_LINK);
+}
+
+static void
+_cb_laddr_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_LINK_ADDRESS);
+}
+
+static void
+_cb_l2hop_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_LINK_2HOP);
+}
+
+static void
+_cb_neighbor_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_NEIGHBOR);
+}
+
+static void
+_cb_naddr_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_NEIGHBOR_ADDRESS);
+}
+
+static void
+_cb_tc_node_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_TC_NODE);
+}
+
+static void
+_cb_tc_edge_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_TC_EDGE);
+}
+
+static void
+_cb_attached_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_ATTACHED);
+}
+
+static void
+_cb_endpoint_added(void *ptr __attribute__((unused))) {
+  _count_allocation(OBJECT_ENDPOINT);
+}
@@ -0,0 +1,554 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "common/common_types.h"
+#include "common/autobuf.h"
+#include "common/list.h"
+#include "common/netaddr.h"
+#include "common/string.h"
+#include "config/cfg_schema.h"
+#include "core/oonf_cfg.h"
+#include "core/oonf_logging.h"
+#include "core/oonf_plugins.h"
+#include "subsystems/oonf_class.h"
+#include "subsystems/oonf_telnet.h"
+
+#include "nhdp/nhdp.h"
+#include "nhdp/nhdp_domain.h"
+
+#include "olsrv2/olsrv2_tc.h"
+
+#include "tc_journal/tc_journal.h"
+
+/* definitions */
+struct _journal_config {
+  int32_t size;
+};
+
+/* types of journaled objects */
+enum _journal_type {
+  _JOURNAL_NODE,
+  _JOURNAL_EDGE,
+  _JOURNAL_ENDPOINT,
+};
+
+/* one topology change */
+struct _journal_entry {
+  /* sequence number of change */
+  uint64_t seqno;
+
+  /* type of object */
+  enum _journal_type type;
+
+  /* OONF_OBJECT_ADDED, _CHANGED or _REMOVED */
+  enum oonf_class_event event;
+
+  /* originator of the changed object */
+  struct netaddr src;
+
+  /* destination of edge or endpoint */
+  struct netaddr dst;
+
+  /* cost of edge or endpoint per domain */
+  uint32_t cost[NHDP_MAXIMUM_DOMAINS];
+};
+
+/* telnet session that receives all new changes */
+struct _journal_subscriber {
+  /* telnet session */
+  struct oonf_telnet_data *con;
+
+  /* member of subscriber list */
+  struct list_entity _node;
+};
+
+/* prototypes */
+static int _init(void);
+static void _cleanup(void);
+
+static void _cb_node_added(void *);
+static void _cb_node_removed(void *);
+static void _cb_edge_added(void *);
+static void _cb_edge_changed(void *);
+static void _cb_edge_removed(void *);
+static void _cb_attached_added(void *);
+static void _cb_attached_changed(void *);
+static void _cb_attached_removed(void *);
+
+static void _add_node_entry(struct olsrv2_tc_node *, enum oonf_class_event);
+static void _add_edge_entry(struct olsrv2_tc_edge *, enum oonf_class_event);
+static void _add_attached_entry(
+    struct olsrv2_tc_attachment *, enum oonf_class_event);
+static struct _journal_entry *_add_entry(enum _journal_type type,
+    enum oonf_class_event event, const struct netaddr *src);
+static void _commit_entry(struct _journal_entry *);
+static void _print_entry(struct autobuf *, struct _journal_entry *);
+
+static enum oonf_telnet_result _cb_telnet_journal(struct oonf_telnet_data *con);
+static void _cb_telnet_stop(struct oonf_telnet_data *con);
+
+static void _cb_cfg_changed(void);
+
+/* plugin declaration */
+static struct cfg_schema_entry _journal_entries[] = {
+  CFG_MAP_INT32_MINMAX(_journal_config, size, "size", "1024",
+      "Number of topology changes stored in the journal", 0, false, 16, 1048576),
+};
+
+static struct cfg_schema_section _journal_section = {
+  .type = OONF_PLUGIN_GET_NAME(),
+  .cb_delta_handler = _cb_cfg_changed,
+  .entries = _journal_entries,
+  .entry_count = ARRAYSIZE(_journal_entries),
+};
+
+static struct _journal_config _config;
+
+struct oonf_subsystem olsrv2_tc_journal_subsystem = {
+  .name = OONF_PLUGIN_GET_NAME(),
+  .descr = "OLSRv2 topology change journal plugin",
+  .author = "Henning Rogge",
+
+  .cfg_section = &_journal_section,
+
+  .init = _init,
+  .cleanup = _cleanup,
+};
+DECLARE_OONF_PLUGIN(olsrv2_tc_journal_subsystem);
+
+/* topology database listeners */
+static struct oonf_class_extension _node_listener = {
+  .ext_name = "tc journal",
+  .class_name = OLSRV2_CLASS_TC_NODE,
+
+  .cb_add = _cb_node_added,
+  .cb_remove = _cb_node_removed,
+};
+
+static struct oonf_class_extension _edge_listener = {
+  .ext_name = "tc journal",
+  .class_name = OLSRV2_CLASS_TC_EDGE,
+
+  .cb_add = _cb_edge_added,
+  .cb_change = _cb_edge_changed,
+  .cb_remove = _cb_edge_removed,
+};
+
+static struct oonf_class_extension _attached_listener = {
+  .ext_name = "tc journal",
+  .class_name = OLSRV2_CLASS_ATTACHED,
+
+  .cb_add = _cb_attached_added,
+  .cb_change = _cb_attached_changed,
+  .cb_remove = _cb_attached_removed,
+};
+
+/* subscriber memory */
+static struct oonf_class _subscriber_class = {
+  .name = "tc journal subscriber",
+  .size = sizeof(struct _journal_subscriber),
+};
+
+/* telnet command */
+static struct oonf_telnet_command _cmds[] = {
+    TELNET_CMD("tc_journal", _cb_telnet_journal,
+        "Topology change journal\n"
+        "\"tc_journal\": shows the range of stored sequence numbers\n"
+        "\"tc_journal <seqno>\": shows all changes after sequence number <seqno>\n"
+        "\"tc_journal follow <seqno>\": shows all changes after <seqno> and"
+        " continues to show new changes until the session ends\n"),
+};
+
+/* ring buffer of journal entries */
+static struct _journal_entry *_ring = NULL;
+static size_t _ring_size = 0;
+
+/* sequence number of the next entry, first entry has seqno 1 */
+static uint64_t _next_seqno = 1;
+
+/* oldest sequence number that might still be in the journal */
+static uint64_t _first_seqno = 1;
+
+/* list of continuous telnet sessions */
+static struct list_entity _subscriber_list;
+
+/**
+ * Initialize plugin
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_init(void) {
+  size_t i;
+
+  if (oonf_class_extension_add(&_node_listener)) {
+    return -1;
+  }
+  if (oonf_class_extension_add(&_edge_listener)) {
+    oonf_class_extension_remove(&_node_listener);
+    return -1;
+  }
+  if (oonf_class_extension_add(&_attached_listener)) {
+    oonf_class_extension_remove(&_edge_listener);
+    oonf_class_extension_remove(&_node_listener);
+    return -1;
+  }
+
+  oonf_class_add(&_subscriber_class);
+  list_init_head(&_subscriber_list);
+
+  for (i=0; i<ARRAYSIZE(_cmds); i++) {
+    oonf_telnet_add(&_cmds[i]);
+  }
+  return 0;
+}
+
+/**
+ * Cleanup plugin
+ */
+static void
+_cleanup(void) {
+  struct _journal_subscriber *sub, *sub_it;
+  size_t i;
+
+  for (i=0; i<ARRAYSIZE(_cmds); i++) {
+    oonf_telnet_remove(&_cmds[i]);
+  }
+
+  list_for_each_element_safe(&_subscriber_list, sub, _node, sub_it) {
+    oonf_telnet_stop(sub->con);
+  }
+
+  oonf_class_remove(&_subscriber_class);
+
+  oonf_class_extension_remove(&_attached_listener);
+  oonf_class_extension_remove(&_edge_listener);
+  oonf_class_extension_remove(&_node_listener);
+
+  free(_ring);
+  _ring = NULL;
+  _ring_size = 0;
+}
+
+static void
+_cb_node_added(void *ptr) {
+  _add_node_entry(ptr, OONF_OBJECT_ADDED);
+}
+
+static void
+_cb_node_removed(void *ptr) {
+  _add_node_entry(ptr, OONF_OBJECT_REMOVED);
+}
+
+static void
+_cb_edge_added(void *ptr) {
+  _add_edge_entry(ptr, OONF_OBJECT_ADDED);
+}
+
+static void
+_cb_edge_changed(void *ptr) {
+  _add_edge_entry(ptr, OONF_OBJECT_CHANGED);
+}
+
+static void
+_cb_edge_removed(void *ptr) {
+  _add_edge_entry(ptr, OONF_OBJECT_REMOVED);
+}
+
+static void
+_cb_attached_added(void *ptr) {
+  _add_attached_entry(ptr, OONF_OBJECT_ADDED);
+}
+
+static void
+_cb_attached_changed(void *ptr) {
+  _add_attached_entry(ptr, OONF_OBJECT_CHANGED);
+}
+
+static void
+_cb_attached_removed(void *ptr) {
+  _add_attached_entry(ptr, OONF_OBJECT_REMOVED);
+}
+
+/**
+ * Record a change of a tc node
+ * @param node pointer to tc node
+ * @param event type of change
+ */
+static void
+_add_node_entry(struct olsrv2_tc_node *node, enum oonf_class_event event) {
+  struct _journal_entry *entry;
+
+  entry = _add_entry(_JOURNAL_NODE, event, &node->target.addr);
+  if (entry) {
+    _commit_entry(entry);
+  }
+}
+
+/**
+ * Record a change of a tc edge
+ * @param edge pointer to tc edge
+ * @param event type of change
+ */
+static void
+_add_edge_entry(struct olsrv2_tc_edge *edge, enum oonf_class_event event) {
+  struct _journal_entry *entry;
+  struct nhdp_domain *domain;
+
+  entry = _add_entry(_JOURNAL_EDGE, event, &edge->src->target.addr);
+  if (entry) {
+    memcpy(&entry->dst, &edge->dst->target.addr, sizeof(entry->dst));
+    list_for_each_element(&nhdp_domain_list, domain, _node) {
+      entry->cost[domain->index] =
+          olsrv2_tc_edge_get_domaindata(domain, edge)->cost;
+    }
+    _commit_entry(entry);
+  }
+}
+
+/**
+ * Record a change of a tc attachment
+ * @param net pointer to tc attachment
+ * @param event type of change
+ */
+static void
+_add_attached_entry(struct olsrv2_tc_attachment *net,
+    enum oonf_class_event event) {
+  struct _journal_entry *entry;
+  struct nhdp_domain *domain;
+
+  entry = _add_entry(_JOURNAL_ENDPOINT, event, &net->src->target.addr);
+  if (entry) {
+    memcpy(&entry->dst, &net->dst->target.addr, sizeof(entry->dst));
+    list_for_each_element(&nhdp_domain_list, domain, _node) {
+      entry->cost[domain->index] =
+          olsrv2_tc_attachment_get_domaindata(domain, net)->cost;
+    }
+    _commit_entry(entry);
+  }
+}
+
+/**
+ * Allocate the next slot of the journal ring buffer
+ * @param type type of changed object
+ * @param event type of change
+ * @param src originator of changed object
+ * @return pointer to journal entry, NULL if journal is not active
+ */
+static struct _journal_entry *
+_add_entry(enum _journal_type type, enum oonf_class_event event,
+    const struct netaddr *src) {
+  struct _journal_entry *entry;
+
+  if (_ring_size == 0) {
+    return NULL;
+  }
+
+  entry = &_ring[_next_seqno % _ring_size];
+  memset(entry, 0, sizeof(*entry));
+
+  entry->seqno = _next_seqno++;
+  entry->type = type;
+  entry->event = event;
+  memcpy(&entry->src, src, sizeof(*src));
+  return entry;
+}
+
+/**
+ * Send a new journal entry to all continuous telnet sessions
+ * @param entry pointer to journal entry
+ */
+static void
+_commit_entry(struct _journal_entry *entry) {
+  struct _journal_subscriber *sub;
+
+  list_for_each_element(&_subscriber_list, sub, _node) {
+    _print_entry(sub->con->out, entry);
+    oonf_telnet_flush_session(sub->con);
+  }
+}
+
+/**
+ * Print a journal entry into a buffer
+ * @param out output buffer
+ * @param entry pointer to journal entry
+ */
+static void
+_print_entry(struct autobuf *out, struct _journal_entry *entry) {
+  static const char *EVENTS[] = {
+    [OONF_OBJECT_ADDED] = "add",
+    [OONF_OBJECT_CHANGED] = "change",
+    [OONF_OBJECT_REMOVED] = "remove",
+  };
+  static const char *TYPES[] = {
+    [_JOURNAL_NODE] = "node",
+    [_JOURNAL_EDGE] = "edge",
+    [_JOURNAL_ENDPOINT] = "endpoint",
+  };
+  struct nhdp_domain *domain;
+  struct netaddr_str nbuf1, nbuf2;
+
+  abuf_appendf(out, "%"PRIu64" %s %s %s", entry->seqno,
+      EVENTS[entry->event], TYPES[entry->type],
+      netaddr_to_string(&nbuf1, &entry->src));
+
+  if (entry->type != _JOURNAL_NODE) {
+    abuf_appendf(out, " %s", netaddr_to_string(&nbuf2, &entry->dst));
+
+    list_for_each_element(&nhdp_domain_list, domain, _node) {
+      abuf_appendf(out, " %u", entry->cost[domain->index]);
+    }
+  }
+  abuf_puts(out, "\n");
+}
+
+/**
+ * Telnet command to output the topology change journal
+ * @param con telnet session
+ * @return telnet result
+ */
+static enum oonf_telnet_result
+_cb_telnet_journal(struct oonf_telnet_data *con) {
+  struct _journal_subscriber *sub;
+  struct _journal_entry *entry;
+  const char *next;
+  uint64_t first, seqno;
+  bool follow;
+
+  if (_ring_size == 0) {
+    abuf_puts(con->out, "Topology journal is not active\n");
+    return TELNET_RESULT_ACTIVE;
+  }
+
+  /* first sequence number still stored in the journal */
+  first = _first_seqno;
+  if (_next_seqno - first > _ring_size) {
+    first = _next_seqno - _ring_size;
+  }
+
+  if (con->parameter == NULL || *con->parameter == 0) {
+    abuf_appendf(con->out, "first %"PRIu64" last %"PRIu64"\n",
+        first, _next_seqno - 1);
+    return TELNET_RESULT_ACTIVE;
+  }
+
+  next = str_hasnextword(con->parameter, "follow");
+  follow = next != NULL;
+  if (!follow) {
+    next = con->parameter;
+  }
+
+  seqno = strtoull(next, NULL, 10);
+  if (seqno + 1 < first || seqno >= _next_seqno) {
+    /* client lost changes, it has to read the full topology again */
+    abuf_appendf(con->out, "reset %"PRIu64"\n", _next_seqno - 1);
+    seqno = _next_seqno - 1;
+  }
+
+  for (seqno++; seqno < _next_seqno; seqno++) {
+    entry = &_ring[seqno % _ring_size];
+    _print_entry(con->out, entry);
+  }
+
+  if (!follow) {
+    return TELNET_RESULT_ACTIVE;
+  }
+
+  sub = oonf_class_malloc(&_subscriber_class);
+  if (sub == NULL) {
+    return TELNET_RESULT_INTERNAL_ERROR;
+  }
+
+  sub->con = con;
+  list_add_tail(&_subscriber_list, &sub->_node);
+
+  con->stop_handler = _cb_telnet_stop;
+  con->stop_data[0] = sub;
+  return TELNET_RESULT_CONTINOUS;
+}
+
+/**
+ * Callback triggered when a continuous telnet session ends
+ * @param con telnet session
+ */
+static void
+_cb_telnet_stop(struct oonf_telnet_data *con) {
+  struct _journal_subscriber *sub;
+
+  sub = con->stop_data[0];
+  list_remove(&sub->_node);
+  oonf_class_free(&_subscriber_class, sub);
+
+  con->stop_handler = NULL;
+  con->stop_data[0] = NULL;
+}
+
+/**
+ * Callback triggered when configuration changes
+ */
+static void
+_cb_cfg_changed(void) {
+  struct _journal_entry *ring;
+
+  if (cfg_schema_tobin(&_config, _journal_section.post,
+      _journal_entries, ARRAYSIZE(_journal_entries))) {
+    OONF_WARN(LOG_TC_JOURNAL, "Cannot convert configuration for %s",
+        OONF_PLUGIN_GET_NAME());
+    return;
+  }
+
+  if ((size_t)_config.size == _ring_size) {
+    return;
+  }
+
+  ring = calloc(_config.size, sizeof(*ring));
+  if (ring == NULL) {
+    OONF_WARN(LOG_TC_JOURNAL, "Out of memory for topology journal");
+    return;
+  }
+
+  /* a resized journal starts empty, clients will get a reset */
+  free(_ring);
+  _ring = ring;
+  _ring_size = _config.size;
+  _first_seqno = _next_seqno;
+}
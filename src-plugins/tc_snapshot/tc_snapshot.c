@@ -0,0 +1,665 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common/common_types.h"
+#include "common/autobuf.h"
+#include "common/avl.h"
+#include "common/avl_comp.h"
+#include "common/netaddr.h"
+#include "config/cfg_schema.h"
+#include "core/oonf_cfg.h"
+#include "core/oonf_logging.h"
+#include "core/oonf_plugins.h"
+#include "subsystems/oonf_timer.h"
+
+#include "nhdp/nhdp.h"
+#include "nhdp/nhdp_domain.h"
+
+#include "olsrv2/olsrv2_originator.h"
+#include "olsrv2/olsrv2_routing.h"
+#include "olsrv2/olsrv2_tc.h"
+
+#include "tc_snapshot/tc_snapshot_format.h"
+#include "tc_snapshot/tc_snapshot.h"
+
+/* definitions */
+struct _snapshot_config {
+  char file[256];
+  uint64_t interval;
+  uint64_t provisional_validity;
+};
+
+/* prototypes */
+static int _init(void);
+static void _cleanup(void);
+
+static void _cb_write_snapshot(void *);
+static void _cb_load_snapshot(void *);
+static int _write_snapshot(const char *file);
+static int _load_snapshot(const char *file);
+static struct olsrv2_tc_node *_get_loaded_node(
+    const struct tc_snapshot_node *s_nodes, bool *loaded, uint32_t idx);
+static int _find_node_index(struct olsrv2_tc_node **nodes,
+    uint32_t count, const struct netaddr *addr);
+static void _addr_to_snapshot(struct tc_snapshot_addr *dst,
+    const struct netaddr *src);
+static int _addr_from_snapshot(struct netaddr *dst,
+    const struct tc_snapshot_addr *src);
+
+static void _cb_cfg_changed(void);
+
+/* plugin declaration */
+static struct cfg_schema_entry _snapshot_entries[] = {
+  CFG_MAP_STRING_ARRAY(_snapshot_config, file, "file", "",
+      "Filename of the topology snapshot, empty to disable snapshots", 256),
+  CFG_MAP_CLOCK_MIN(_snapshot_config, interval, "interval", "60.0",
+      "Time interval between two snapshots of the topology database", 1000),
+  CFG_MAP_CLOCK_MIN(_snapshot_config, provisional_validity,
+      "provisional_validity", "15.0",
+      "Validity time of topology entries loaded from the snapshot"
+      " at startup", 1000),
+};
+
+static struct cfg_schema_section _snapshot_section = {
+  .type = OONF_PLUGIN_GET_NAME(),
+  .cb_delta_handler = _cb_cfg_changed,
+  .entries = _snapshot_entries,
+  .entry_count = ARRAYSIZE(_snapshot_entries),
+};
+
+static struct _snapshot_config _config;
+
+struct oonf_subsystem olsrv2_tc_snapshot_subsystem = {
+  .name = OONF_PLUGIN_GET_NAME(),
+  .descr = "OLSRv2 topology snapshot plugin",
+  .author = "Henning Rogge",
+
+  .cfg_section = &_snapshot_section,
+
+  .init = _init,
+  .cleanup = _cleanup,
+};
+DECLARE_OONF_PLUGIN(olsrv2_tc_snapshot_subsystem);
+
+/* timer for writing snapshots */
+static struct oonf_timer_info _snapshot_timer_info = {
+  .name = "Topology snapshot timer",
+  .callback = _cb_write_snapshot,
+  .periodic = true,
+};
+
+static struct oonf_timer_entry _snapshot_timer = {
+  .info = &_snapshot_timer_info,
+};
+
+/*
+ * timer for loading the snapshot. The tc database carries per-domain
+ * data, so it must not contain entries before all NHDP domains of the
+ * startup configuration have been added. The timer fires in the first
+ * scheduler run, after every configuration handler has been called.
+ */
+static struct oonf_timer_info _load_timer_info = {
+  .name = "Topology snapshot load timer",
+  .callback = _cb_load_snapshot,
+};
+
+static struct oonf_timer_entry _load_timer = {
+  .info = &_load_timer_info,
+};
+
+/* true if the snapshot has already been loaded */
+static bool _loaded = false;
+
+/**
+ * Initialize plugin
+ * @return always returns 0
+ */
+static int
+_init(void) {
+  oonf_timer_add(&_snapshot_timer_info);
+  oonf_timer_add(&_load_timer_info);
+  return 0;
+}
+
+/**
+ * Cleanup plugin
+ */
+static void
+_cleanup(void) {
+  /* store the final state of the topology for the next start */
+  if (_config.file[0] && _loaded) {
+    _write_snapshot(_config.file);
+  }
+
+  oonf_timer_stop(&_load_timer);
+  oonf_timer_remove(&_load_timer_info);
+  oonf_timer_stop(&_snapshot_timer);
+  oonf_timer_remove(&_snapshot_timer_info);
+}
+
+/**
+ * Timer callback to write a snapshot of the topology database
+ * @param ptr not used
+ */
+static void
+_cb_write_snapshot(void *ptr __attribute__((unused))) {
+  if (_config.file[0] && _loaded) {
+    _write_snapshot(_config.file);
+  }
+}
+
+/**
+ * Timer callback to load the snapshot once after startup
+ * @param ptr not used
+ */
+static void
+_cb_load_snapshot(void *ptr __attribute__((unused))) {
+  if (_config.file[0] && !_loaded) {
+    /* warm start from the last snapshot */
+    _load_snapshot(_config.file);
+  }
+  _loaded = true;
+}
+
+/**
+ * Write the current topology database into a snapshot file.
+ * The file is written to a temporary name first and renamed
+ * afterwards, so readers never see a partial snapshot.
+ * @param file name of snapshot file
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_write_snapshot(const char *file) {
+  struct tc_snapshot_header hdr;
+  struct tc_snapshot_node s_node;
+  struct tc_snapshot_edge s_edge;
+  struct tc_snapshot_attachment s_attached;
+  struct olsrv2_tc_node **nodes, *node;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_attachment *attached;
+  struct olsrv2_tc_attachment_domaindata *attached_data;
+  struct nhdp_domain *domain;
+  struct autobuf out;
+  char tmpfile[sizeof(_config.file) + 4];
+  uint32_t idx;
+  int dst, result;
+  FILE *f;
+
+  result = -1;
+  nodes = NULL;
+
+  if (abuf_init(&out)) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Out of memory for topology snapshot");
+    return -1;
+  }
+
+  if (olsrv2_tc_tree.count > 0) {
+    nodes = calloc(olsrv2_tc_tree.count, sizeof(*nodes));
+    if (nodes == NULL) {
+      OONF_WARN(LOG_TC_SNAPSHOT, "Out of memory for topology snapshot");
+      goto write_cleanup;
+    }
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, TC_SNAPSHOT_MAGIC, sizeof(hdr.magic));
+  hdr.version = TC_SNAPSHOT_VERSION;
+  hdr.byteorder = TC_SNAPSHOT_BYTEORDER;
+  hdr.timestamp = time(NULL);
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    if (domain->index < TC_SNAPSHOT_MAX_DOMAINS) {
+      hdr.domain_ext[domain->index] = domain->ext;
+    }
+  }
+  hdr.domain_count = nhdp_domain_get_count();
+  if (hdr.domain_count > TC_SNAPSHOT_MAX_DOMAINS) {
+    hdr.domain_count = TC_SNAPSHOT_MAX_DOMAINS;
+  }
+
+  /* count records first, node order is the order of the tc tree */
+  idx = 0;
+  avl_for_each_element(&olsrv2_tc_tree, node, _originator_node) {
+    nodes[idx++] = node;
+
+    avl_for_each_element(&node->_edges, edge, _node) {
+      if (!edge->virtual) {
+        hdr.edge_count++;
+      }
+    }
+    hdr.attachment_count += node->_endpoints.count;
+  }
+  hdr.node_count = idx;
+
+  abuf_memcpy(&out, &hdr, sizeof(hdr));
+
+  for (idx=0; idx<hdr.node_count; idx++) {
+    node = nodes[idx];
+
+    memset(&s_node, 0, sizeof(s_node));
+    _addr_to_snapshot(&s_node.originator, &node->target.addr);
+    s_node.interval_time = node->interval_time;
+    s_node.ansn = node->ansn;
+    if (!oonf_timer_is_active(&node->_validity_time)) {
+      s_node.flags |= TC_SNAPSHOT_NODE_VIRTUAL;
+    }
+    abuf_memcpy(&out, &s_node, sizeof(s_node));
+  }
+
+  for (idx=0; idx<hdr.node_count; idx++) {
+    avl_for_each_element(&nodes[idx]->_edges, edge, _node) {
+      if (edge->virtual) {
+        continue;
+      }
+
+      dst = _find_node_index(nodes, hdr.node_count, &edge->dst->target.addr);
+      if (dst < 0) {
+        /* should not happen, every edge destination is a tc node */
+        goto write_cleanup;
+      }
+
+      memset(&s_edge, 0, sizeof(s_edge));
+      s_edge.src = idx;
+      s_edge.dst = dst;
+      s_edge.ansn = edge->ansn;
+      list_for_each_element(&nhdp_domain_list, domain, _node) {
+        if (domain->index < TC_SNAPSHOT_MAX_DOMAINS) {
+          s_edge.cost[domain->index] =
+              olsrv2_tc_edge_get_domaindata(domain, edge)->cost;
+        }
+      }
+      abuf_memcpy(&out, &s_edge, sizeof(s_edge));
+    }
+  }
+
+  for (idx=0; idx<hdr.node_count; idx++) {
+    avl_for_each_element(&nodes[idx]->_endpoints, attached, _src_node) {
+      memset(&s_attached, 0, sizeof(s_attached));
+      _addr_to_snapshot(&s_attached.prefix, &attached->dst->target.addr);
+      s_attached.src = idx;
+      s_attached.ansn = attached->ansn;
+      s_attached.type =
+          attached->dst->target.type == OLSRV2_ADDRESS_TARGET
+          ? TC_SNAPSHOT_ADDRESS : TC_SNAPSHOT_NETWORK;
+      list_for_each_element(&nhdp_domain_list, domain, _node) {
+        if (domain->index < TC_SNAPSHOT_MAX_DOMAINS) {
+          attached_data =
+              olsrv2_tc_attachment_get_domaindata(domain, attached);
+          s_attached.cost[domain->index] = attached_data->cost;
+          s_attached.distance[domain->index] = attached_data->distance;
+        }
+      }
+      abuf_memcpy(&out, &s_attached, sizeof(s_attached));
+    }
+  }
+
+  if (abuf_getlen(&out) != tc_snapshot_get_size(&hdr)) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Out of memory for topology snapshot");
+    goto write_cleanup;
+  }
+
+  snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", file);
+  f = fopen(tmpfile, "w");
+  if (f == NULL) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Cannot open snapshot file '%s': %s (%d)",
+        tmpfile, strerror(errno), errno);
+    goto write_cleanup;
+  }
+
+  if (fwrite(abuf_getptr(&out), abuf_getlen(&out), 1, f) != 1) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Cannot write snapshot file '%s': %s (%d)",
+        tmpfile, strerror(errno), errno);
+    fclose(f);
+    unlink(tmpfile);
+    goto write_cleanup;
+  }
+  fclose(f);
+
+  if (rename(tmpfile, file)) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Cannot rename snapshot file '%s': %s (%d)",
+        tmpfile, strerror(errno), errno);
+    unlink(tmpfile);
+    goto write_cleanup;
+  }
+
+  OONF_DEBUG(LOG_TC_SNAPSHOT, "Wrote snapshot with %u nodes, %u edges"
+      " and %u attachments", hdr.node_count, hdr.edge_count,
+      hdr.attachment_count);
+  result = 0;
+
+write_cleanup:
+  free(nodes);
+  abuf_free(&out);
+  return result;
+}
+
+/**
+ * Load a snapshot file into the topology database. All nodes
+ * get a short provisional validity time, so real TC messages
+ * will replace the data soon.
+ * @param file name of snapshot file
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_load_snapshot(const char *file) {
+  const struct tc_snapshot_header *hdr;
+  const struct tc_snapshot_node *s_nodes;
+  const struct tc_snapshot_edge *s_edge;
+  const struct tc_snapshot_attachment *s_attached;
+  struct olsrv2_tc_node *node;
+  struct olsrv2_tc_edge *edge;
+  struct olsrv2_tc_attachment *attached;
+  struct olsrv2_tc_attachment_domaindata *attached_data;
+  struct nhdp_domain *domain;
+  struct netaddr addr;
+  struct stat st;
+  void *map;
+  uint32_t idx;
+  bool *loaded;
+  int fd, i, result;
+
+  result = -1;
+  loaded = NULL;
+
+  fd = open(file, O_RDONLY);
+  if (fd == -1) {
+    OONF_INFO(LOG_TC_SNAPSHOT, "No snapshot file '%s' to load", file);
+    return -1;
+  }
+
+  if (fstat(fd, &st) || (size_t)st.st_size < sizeof(*hdr)) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Snapshot file '%s' is too short", file);
+    close(fd);
+    return -1;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Cannot map snapshot file '%s': %s (%d)",
+        file, strerror(errno), errno);
+    return -1;
+  }
+
+  hdr = map;
+  if (memcmp(hdr->magic, TC_SNAPSHOT_MAGIC, sizeof(hdr->magic)) != 0
+      || hdr->version != TC_SNAPSHOT_VERSION
+      || hdr->byteorder != TC_SNAPSHOT_BYTEORDER
+      || hdr->domain_count > TC_SNAPSHOT_MAX_DOMAINS
+      || tc_snapshot_get_size(hdr) != (uint64_t)st.st_size) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Snapshot file '%s' has an incompatible format",
+        file);
+    goto load_cleanup;
+  }
+
+  if (hdr->node_count > 0) {
+    loaded = calloc(hdr->node_count, sizeof(*loaded));
+    if (loaded == NULL) {
+      OONF_WARN(LOG_TC_SNAPSHOT, "Out of memory for loading snapshot");
+      goto load_cleanup;
+    }
+  }
+
+  /* create all non-virtual nodes */
+  s_nodes = tc_snapshot_get_nodes(hdr);
+  for (idx=0; idx<hdr->node_count; idx++) {
+    if ((s_nodes[idx].flags & TC_SNAPSHOT_NODE_VIRTUAL) != 0
+        || _addr_from_snapshot(&addr, &s_nodes[idx].originator)
+        || olsrv2_originator_is_local(&addr)) {
+      continue;
+    }
+
+    if (olsrv2_tc_node_get(&addr) != NULL) {
+      /* we already got fresh data for this node */
+      continue;
+    }
+
+    node = olsrv2_tc_node_add(&addr,
+        _config.provisional_validity, s_nodes[idx].ansn);
+    if (node) {
+      node->interval_time = s_nodes[idx].interval_time;
+      loaded[idx] = true;
+    }
+  }
+
+  /* add edges of loaded nodes, destinations might become virtual nodes */
+  s_edge = tc_snapshot_get_edges(hdr);
+  for (idx=0; idx<hdr->edge_count; idx++, s_edge++) {
+    if (s_edge->src >= hdr->node_count || s_edge->dst >= hdr->node_count
+        || _addr_from_snapshot(&addr, &s_nodes[s_edge->dst].originator)) {
+      continue;
+    }
+
+    node = _get_loaded_node(s_nodes, loaded, s_edge->src);
+    if (node == NULL) {
+      continue;
+    }
+
+    edge = olsrv2_tc_edge_add(node, &addr);
+    if (edge == NULL) {
+      continue;
+    }
+
+    edge->ansn = s_edge->ansn;
+    for (i=0; i<(int)hdr->domain_count; i++) {
+      domain = nhdp_domain_get_by_ext(hdr->domain_ext[i]);
+      if (domain) {
+        olsrv2_tc_edge_get_domaindata(domain, edge)->cost = s_edge->cost[i];
+      }
+    }
+  }
+
+  /* add attached networks and addresses of loaded nodes */
+  s_attached = tc_snapshot_get_attachments(hdr);
+  for (idx=0; idx<hdr->attachment_count; idx++, s_attached++) {
+    if (s_attached->src >= hdr->node_count
+        || _addr_from_snapshot(&addr, &s_attached->prefix)) {
+      continue;
+    }
+
+    node = _get_loaded_node(s_nodes, loaded, s_attached->src);
+    if (node == NULL) {
+      continue;
+    }
+
+    attached = olsrv2_tc_endpoint_add(node, &addr,
+        s_attached->type == TC_SNAPSHOT_ADDRESS);
+    if (attached == NULL) {
+      continue;
+    }
+
+    attached->ansn = s_attached->ansn;
+    for (i=0; i<(int)hdr->domain_count; i++) {
+      domain = nhdp_domain_get_by_ext(hdr->domain_ext[i]);
+      if (domain) {
+        attached_data = olsrv2_tc_attachment_get_domaindata(domain, attached);
+        attached_data->cost = s_attached->cost[i];
+        attached_data->distance = s_attached->distance[i];
+      }
+    }
+  }
+
+  OONF_INFO(LOG_TC_SNAPSHOT, "Loaded snapshot '%s' with %u nodes",
+      file, hdr->node_count);
+
+  olsrv2_routing_trigger_update();
+  result = 0;
+
+load_cleanup:
+  free(loaded);
+  munmap(map, st.st_size);
+  return result;
+}
+
+/**
+ * Lookup a tc node that was created from the snapshot. Nodes are
+ * looked up again because a full topology database might have
+ * evicted them while loading.
+ * @param s_nodes array of snapshot node records
+ * @param loaded array of flags for created nodes
+ * @param idx index of node record
+ * @return pointer to tc node, NULL if not available anymore
+ */
+static struct olsrv2_tc_node *
+_get_loaded_node(const struct tc_snapshot_node *s_nodes,
+    bool *loaded, uint32_t idx) {
+  struct olsrv2_tc_node *node;
+  struct netaddr addr;
+
+  if (!loaded[idx] || _addr_from_snapshot(&addr, &s_nodes[idx].originator)) {
+    return NULL;
+  }
+
+  node = olsrv2_tc_node_get(&addr);
+  if (node == NULL || !oonf_timer_is_active(&node->_validity_time)) {
+    return NULL;
+  }
+  return node;
+}
+
+/**
+ * Lookup the index of a tc node in the (sorted) node array
+ * @param nodes array of tc nodes in tc tree order
+ * @param count number of nodes in array
+ * @param addr originator address
+ * @return index of node, -1 if not found
+ */
+static int
+_find_node_index(struct olsrv2_tc_node **nodes,
+    uint32_t count, const struct netaddr *addr) {
+  uint32_t low, high, mid;
+  int result;
+
+  low = 0;
+  high = count;
+  while (low < high) {
+    mid = low + (high - low) / 2;
+
+    result = avl_comp_netaddr(&nodes[mid]->target.addr, addr);
+    if (result == 0) {
+      return mid;
+    }
+    if (result < 0) {
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Convert a netaddr into a snapshot address
+ * @param dst pointer to snapshot address
+ * @param src pointer to netaddr
+ */
+static void
+_addr_to_snapshot(struct tc_snapshot_addr *dst, const struct netaddr *src) {
+  memset(dst, 0, sizeof(*dst));
+  memcpy(dst->addr, netaddr_get_binptr(src), netaddr_get_binlength(src));
+  dst->family = netaddr_get_address_family(src);
+  dst->prefix_len = netaddr_get_prefix_length(src);
+}
+
+/**
+ * Convert a snapshot address into a netaddr
+ * @param dst pointer to netaddr
+ * @param src pointer to snapshot address
+ * @return -1 if address was invalid, 0 otherwise
+ */
+static int
+_addr_from_snapshot(struct netaddr *dst, const struct tc_snapshot_addr *src) {
+  size_t len;
+
+  switch (src->family) {
+    case AF_INET:
+      len = 4;
+      break;
+    case AF_INET6:
+      len = 16;
+      break;
+    default:
+      return -1;
+  }
+
+  if (src->prefix_len > len * 8) {
+    return -1;
+  }
+  if (netaddr_from_binary(dst, src->addr, len, src->family)) {
+    return -1;
+  }
+  netaddr_set_prefix_length(dst, src->prefix_len);
+  return 0;
+}
+
+/**
+ * Callback triggered when configuration changes
+ */
+static void
+_cb_cfg_changed(void) {
+  if (cfg_schema_tobin(&_config, _snapshot_section.post,
+      _snapshot_entries, ARRAYSIZE(_snapshot_entries))) {
+    OONF_WARN(LOG_TC_SNAPSHOT, "Cannot convert configuration for %s",
+        OONF_PLUGIN_GET_NAME());
+    return;
+  }
+
+  if (_config.file[0] == 0) {
+    oonf_timer_stop(&_snapshot_timer);
+    return;
+  }
+
+  if (!_loaded && !oonf_timer_is_active(&_load_timer)) {
+    oonf_timer_set(&_load_timer, 1);
+  }
+
+  oonf_timer_set(&_snapshot_timer, _config.interval);
+}
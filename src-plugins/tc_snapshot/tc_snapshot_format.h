@@ -0,0 +1,218 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef TC_SNAPSHOT_FORMAT_H_
+#define TC_SNAPSHOT_FORMAT_H_
+
+/*
+ * Binary layout of a topology snapshot file.
+ *
+ * The file consists of a header, followed by an array of node records,
+ * an array of edge records and an array of attachment records. All
+ * records have a fixed size and natural alignment, so the file can be
+ * mapped into memory and used directly. Values are stored in host byte
+ * order, the byteorder field of the header allows a reader to detect
+ * snapshots written on a different architecture.
+ *
+ * This header must not depend on the OONF framework, it is used by
+ * the standalone snapshot tool too.
+ */
+
+#include <stdint.h>
+
+#define TC_SNAPSHOT_MAGIC "OLSRV2TC"
+
+enum {
+  /* current version of the file format */
+  TC_SNAPSHOT_VERSION = 1,
+
+  /* written into the header in host byte order */
+  TC_SNAPSHOT_BYTEORDER = 0x01020304,
+
+  /* number of domain slots in each record */
+  TC_SNAPSHOT_MAX_DOMAINS = 4,
+};
+
+/* types of attachment targets */
+enum tc_snapshot_attachment_type {
+  TC_SNAPSHOT_ADDRESS = 1,
+  TC_SNAPSHOT_NETWORK = 2,
+};
+
+/* node flags */
+enum {
+  /* node is only known through edges of other nodes */
+  TC_SNAPSHOT_NODE_VIRTUAL = 1,
+};
+
+/* address or prefix, independent of the in-memory netaddr layout */
+struct tc_snapshot_addr {
+  /* binary address, IPv4 addresses use the first four bytes */
+  uint8_t addr[16];
+
+  /* AF_INET or AF_INET6 */
+  uint8_t family;
+
+  /* prefix length in bits */
+  uint8_t prefix_len;
+
+  uint8_t _padding[2];
+};
+
+struct tc_snapshot_header {
+  /* TC_SNAPSHOT_MAGIC without terminating zero */
+  char magic[8];
+
+  /* TC_SNAPSHOT_VERSION */
+  uint32_t version;
+
+  /* TC_SNAPSHOT_BYTEORDER */
+  uint32_t byteorder;
+
+  /* unix time when snapshot was written */
+  uint64_t timestamp;
+
+  /* number of records following the header */
+  uint32_t node_count;
+  uint32_t edge_count;
+  uint32_t attachment_count;
+
+  /* number of valid entries in domain_ext */
+  uint32_t domain_count;
+
+  /* extension id of the domain stored in each cost slot */
+  uint8_t domain_ext[TC_SNAPSHOT_MAX_DOMAINS];
+
+  uint8_t _padding[4];
+};
+
+struct tc_snapshot_node {
+  /* originator address */
+  struct tc_snapshot_addr originator;
+
+  /* reported interval time in milliseconds */
+  uint32_t interval_time;
+
+  /* answer set number */
+  uint16_t ansn;
+
+  /* TC_SNAPSHOT_NODE_* flags */
+  uint16_t flags;
+};
+
+struct tc_snapshot_edge {
+  /* index of source and destination node */
+  uint32_t src;
+  uint32_t dst;
+
+  /* link cost for each domain */
+  uint32_t cost[TC_SNAPSHOT_MAX_DOMAINS];
+
+  /* answer set number which set this edge */
+  uint16_t ansn;
+
+  uint8_t _padding[2];
+};
+
+struct tc_snapshot_attachment {
+  /* address or prefix of endpoint */
+  struct tc_snapshot_addr prefix;
+
+  /* index of source node */
+  uint32_t src;
+
+  /* link cost for each domain */
+  uint32_t cost[TC_SNAPSHOT_MAX_DOMAINS];
+
+  /* distance to attached network for each domain */
+  uint8_t distance[TC_SNAPSHOT_MAX_DOMAINS];
+
+  /* answer set number which set this attachment */
+  uint16_t ansn;
+
+  /* tc_snapshot_attachment_type */
+  uint8_t type;
+
+  uint8_t _padding;
+};
+
+/**
+ * @param hdr pointer to snapshot header
+ * @return total size of snapshot file described by header
+ */
+static inline uint64_t
+tc_snapshot_get_size(const struct tc_snapshot_header *hdr) {
+  return sizeof(*hdr)
+      + (uint64_t)hdr->node_count * sizeof(struct tc_snapshot_node)
+      + (uint64_t)hdr->edge_count * sizeof(struct tc_snapshot_edge)
+      + (uint64_t)hdr->attachment_count * sizeof(struct tc_snapshot_attachment);
+}
+
+/**
+ * @param hdr pointer to mapped snapshot header
+ * @return pointer to first node record
+ */
+static inline const struct tc_snapshot_node *
+tc_snapshot_get_nodes(const struct tc_snapshot_header *hdr) {
+  return (const struct tc_snapshot_node *)(hdr + 1);
+}
+
+/**
+ * @param hdr pointer to mapped snapshot header
+ * @return pointer to first edge record
+ */
+static inline const struct tc_snapshot_edge *
+tc_snapshot_get_edges(const struct tc_snapshot_header *hdr) {
+  return (const struct tc_snapshot_edge *)
+      (tc_snapshot_get_nodes(hdr) + hdr->node_count);
+}
+
+/**
+ * @param hdr pointer to mapped snapshot header
+ * @return pointer to first attachment record
+ */
+static inline const struct tc_snapshot_attachment *
+tc_snapshot_get_attachments(const struct tc_snapshot_header *hdr) {
+  return (const struct tc_snapshot_attachment *)
+      (tc_snapshot_get_edges(hdr) + hdr->edge_count);
+}
+
+#endif /* TC_SNAPSHOT_FORMAT_H_ */
@@ -0,0 +1,481 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+/*
+ * Size model for the address blocks of TC messages, used by the snapshot
+ * tool to compare the message size of the recorded neighborhoods in
+ * database order with the address order planned by the olsrv2 writer.
+ *
+ * The model follows RFC 5444: addresses are split greedily into address
+ * blocks with a common head and tail, each block has its own address TLV
+ * block and a TLV covers a consecutive index range of the block, either
+ * with a single value or with one value per address.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "common/common_types.h"
+#include "rfc5444/rfc5444_iana.h"
+#include "rfc5444/rfc5444.h"
+
+#include "nhdp/nhdp_address_group.h"
+
+#include "tc_snapshot/tc_snapshot_size.h"
+
+enum {
+  MAX_ENTRY_TLVS = 1 + 2 * TC_SNAPSHOT_MAX_DOMAINS,
+};
+
+/* address TLV of the model */
+struct _size_tlv {
+  uint8_t type;
+  uint8_t ext;
+  uint8_t length;
+  uint8_t _padding;
+  uint16_t value;
+};
+
+/* address of a TC with its TLVs */
+struct _size_entry {
+  struct tc_snapshot_addr addr;
+  struct _size_tlv tlv[MAX_ENTRY_TLVS];
+  uint8_t tlv_count;
+  bool network;
+};
+
+static int _collect_entries(struct _size_entry *entries,
+    const struct tc_snapshot_header *hdr, uint32_t node, int family);
+static void _add_tlv(struct _size_entry *entry,
+    uint8_t type, uint8_t ext, uint8_t length, uint16_t value);
+static uint16_t _metric_encode(uint32_t metric);
+static size_t _get_message_size(struct _size_entry *entries, int count);
+static size_t _get_block_size(struct _size_entry *entries, int count);
+static size_t _get_tlv_size(struct _size_entry *entries, int count,
+    uint8_t type, uint8_t ext);
+static int _cb_compare_entry(const void *, const void *);
+
+/**
+ * Calculate the size of the address blocks of all TCs in the snapshot
+ * with the addresses in database order and in planned order and print
+ * the result.
+ * @param hdr pointer to snapshot header
+ */
+void
+tc_snapshot_size_benchmark(const struct tc_snapshot_header *hdr) {
+  static const int families[] = { AF_INET, AF_INET6 };
+  struct _size_entry *entries;
+  uint64_t original, planned;
+  uint32_t node, messages;
+  size_t max_entries;
+  int f, count, neigh_count;
+
+  /* no TC can be larger than all edges and attachments */
+  max_entries = hdr->edge_count + hdr->attachment_count + 1;
+  entries = calloc(max_entries, sizeof(*entries));
+  if (entries == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    return;
+  }
+
+  for (f=0; f<2; f++) {
+    original = 0;
+    planned = 0;
+    messages = 0;
+
+    for (node=0; node<hdr->node_count; node++) {
+      count = _collect_entries(entries, hdr, node, families[f]);
+      if (count == 0) {
+        continue;
+      }
+      messages++;
+
+      original += _get_message_size(entries, count);
+
+      /* neighbor addresses are planned, attached networks keep their order */
+      neigh_count = 0;
+      while (neigh_count < count && !entries[neigh_count].network) {
+        neigh_count++;
+      }
+      qsort(entries, neigh_count, sizeof(*entries), _cb_compare_entry);
+
+      planned += _get_message_size(entries, count);
+    }
+
+    if (messages == 0) {
+      continue;
+    }
+
+    printf("IPv%d TCs: %u\n", families[f] == AF_INET ? 4 : 6, messages);
+    printf("  address blocks in database order: %llu bytes (%.1f per TC)\n",
+        (unsigned long long)original, (double)original / messages);
+    printf("  address blocks in planned order:  %llu bytes (%.1f per TC)\n",
+        (unsigned long long)planned, (double)planned / messages);
+    printf("  reduction: %.1f%%\n",
+        original ? 100.0 * (double)(original - planned) / original : 0.0);
+  }
+
+  free(entries);
+}
+
+/**
+ * Collect the addresses a node advertises in its TC for one address
+ * family, neighbor addresses first, then attached networks.
+ * @param entries output array
+ * @param hdr pointer to snapshot header
+ * @param node index of source node
+ * @param family address family
+ * @return number of entries
+ */
+static int
+_collect_entries(struct _size_entry *entries,
+    const struct tc_snapshot_header *hdr, uint32_t node, int family) {
+  const struct tc_snapshot_node *nodes;
+  const struct tc_snapshot_edge *edge;
+  const struct tc_snapshot_attachment *att;
+  struct _size_entry *entry;
+  uint32_t i, d;
+  int count, pass;
+
+  nodes = tc_snapshot_get_nodes(hdr);
+  count = 0;
+
+  edge = tc_snapshot_get_edges(hdr);
+  for (i=0; i<hdr->edge_count; i++, edge++) {
+    if (edge->src != node || edge->dst >= hdr->node_count
+        || nodes[edge->dst].originator.family != family) {
+      continue;
+    }
+
+    entry = &entries[count++];
+    memset(entry, 0, sizeof(*entry));
+    memcpy(&entry->addr, &nodes[edge->dst].originator, sizeof(entry->addr));
+
+    _add_tlv(entry, RFC5444_ADDRTLV_NBR_ADDR_TYPE, 0, 1,
+        RFC5444_NBR_ADDR_TYPE_ORIGINATOR | RFC5444_NBR_ADDR_TYPE_ROUTABLE);
+    for (d=0; d<hdr->domain_count; d++) {
+      _add_tlv(entry, RFC5444_ADDRTLV_LINK_METRIC, hdr->domain_ext[d], 2,
+          _metric_encode(edge->cost[d]));
+    }
+  }
+
+  /* routable addresses first, attached networks in a second pass */
+  for (pass=0; pass<2; pass++) {
+    att = tc_snapshot_get_attachments(hdr);
+    for (i=0; i<hdr->attachment_count; i++, att++) {
+      if (att->src != node || att->prefix.family != family) {
+        continue;
+      }
+      if ((att->type == TC_SNAPSHOT_NETWORK) != (pass == 1)) {
+        continue;
+      }
+
+      entry = &entries[count++];
+      memset(entry, 0, sizeof(*entry));
+      memcpy(&entry->addr, &att->prefix, sizeof(entry->addr));
+      entry->network = pass == 1;
+
+      if (!entry->network) {
+        _add_tlv(entry, RFC5444_ADDRTLV_NBR_ADDR_TYPE, 0, 1,
+            RFC5444_NBR_ADDR_TYPE_ROUTABLE);
+      }
+      for (d=0; d<hdr->domain_count; d++) {
+        if (att->cost[d] >= RFC5444_METRIC_INFINITE) {
+          continue;
+        }
+        _add_tlv(entry, RFC5444_ADDRTLV_LINK_METRIC, hdr->domain_ext[d], 2,
+            _metric_encode(att->cost[d]));
+        if (entry->network) {
+          _add_tlv(entry, RFC5444_ADDRTLV_GATEWAY, hdr->domain_ext[d], 1,
+              att->distance[d]);
+        }
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * Add a TLV to a model address
+ * @param entry pointer to address
+ * @param type tlv type
+ * @param ext tlv extension type
+ * @param length length of tlv value
+ * @param value tlv value
+ */
+static void
+_add_tlv(struct _size_entry *entry,
+    uint8_t type, uint8_t ext, uint8_t length, uint16_t value) {
+  struct _size_tlv *tlv;
+
+  if (entry->tlv_count == MAX_ENTRY_TLVS) {
+    return;
+  }
+
+  tlv = &entry->tlv[entry->tlv_count++];
+  tlv->type = type;
+  tlv->ext = ext;
+  tlv->length = length;
+  tlv->value = value;
+}
+
+/**
+ * Encode a link metric like rfc5444_metric_encode() and add the
+ * outgoing neighbor flag
+ * @param metric link metric
+ * @return encoded tlv value
+ */
+static uint16_t
+_metric_encode(uint32_t metric) {
+  uint32_t a;
+  int b;
+
+  if (metric >= RFC5444_METRIC_INFINITE) {
+    return 0;
+  }
+
+  for (b=0; b<16; b++) {
+    /* smallest representable value (257+a) * 2^b - 256 >= metric */
+    a = (metric + 256 + (1u << b) - 1) >> b;
+    if (a < 257) {
+      a = 257;
+    }
+    if (a - 257 <= 255) {
+      return RFC5444_LINKMETRIC_OUTGOING_NEIGH | (b << 8) | (a - 257);
+    }
+  }
+  return RFC5444_LINKMETRIC_OUTGOING_NEIGH | 0x0fff;
+}
+
+/**
+ * Split addresses greedily into address blocks and calculate their size
+ * @param entries array of addresses
+ * @param count number of addresses
+ * @return size of all address blocks including their TLV blocks
+ */
+static size_t
+_get_message_size(struct _size_entry *entries, int count) {
+  size_t total, current, single, joined;
+  int start, i;
+
+  total = 0;
+  start = 0;
+  current = _get_block_size(&entries[0], 1);
+
+  for (i=1; i<count; i++) {
+    single = _get_block_size(&entries[i], 1);
+
+    /* blocks share a single prefix length */
+    if (entries[i].addr.prefix_len == entries[start].addr.prefix_len) {
+      joined = _get_block_size(&entries[start], i - start + 1);
+      if (joined <= current + single) {
+        current = joined;
+        continue;
+      }
+    }
+
+    /* start a new address block */
+    total += current;
+    start = i;
+    current = single;
+  }
+  return total + current;
+}
+
+/**
+ * Calculate the size of a single address block and its TLV block
+ * @param entries array of addresses of the block
+ * @param count number of addresses
+ * @return size of the block in bytes
+ */
+static size_t
+_get_block_size(struct _size_entry *entries, int count) {
+  struct _size_tlv keys[MAX_ENTRY_TLVS * 2];
+  size_t size, len, head, tail, i, j, k, key_count;
+  const uint8_t *first;
+  int t;
+
+  len = entries[0].addr.family == AF_INET ? 4 : 16;
+  first = entries[0].addr.addr;
+
+  /* common head and tail of all addresses */
+  head = len;
+  tail = len;
+  for (i=1; i<(size_t)count; i++) {
+    for (j=0; j<head && entries[i].addr.addr[j] == first[j]; j++);
+    head = j;
+    for (k=0; k<tail && entries[i].addr.addr[len-1-k] == first[len-1-k]; k++);
+    tail = k;
+  }
+  if (count == 1) {
+    head = 0;
+    tail = 0;
+  }
+  if (head + tail > len) {
+    tail = len - head;
+  }
+
+  /* number of addresses, flags, head, tail, mid parts */
+  size = 2;
+  size += head ? 1 + head : 0;
+  size += tail ? 1 + tail : 0;
+  size += count * (len - head - tail);
+
+  /* single prefix length */
+  if (entries[0].addr.prefix_len != len * 8) {
+    size++;
+  }
+
+  /* length of tlv block */
+  size += 2;
+
+  /* collect tlv types of the block */
+  key_count = 0;
+  for (i=0; i<(size_t)count; i++) {
+    for (t=0; t<entries[i].tlv_count; t++) {
+      for (j=0; j<key_count; j++) {
+        if (keys[j].type == entries[i].tlv[t].type
+            && keys[j].ext == entries[i].tlv[t].ext) {
+          break;
+        }
+      }
+      if (j == key_count && key_count < ARRAYSIZE(keys)) {
+        keys[key_count++] = entries[i].tlv[t];
+      }
+    }
+  }
+
+  for (j=0; j<key_count; j++) {
+    size += _get_tlv_size(entries, count, keys[j].type, keys[j].ext);
+  }
+  return size;
+}
+
+/**
+ * Calculate the size of all TLVs of one type of an address block.
+ * Each run of consecutive addresses with the TLV needs its own TLV,
+ * which is single valued if all addresses of the run share the value.
+ * @param entries array of addresses of the block
+ * @param count number of addresses
+ * @param type tlv type
+ * @param ext tlv extension type
+ * @return size of the TLVs in bytes
+ */
+static size_t
+_get_tlv_size(struct _size_entry *entries, int count,
+    uint8_t type, uint8_t ext) {
+  const struct _size_tlv *tlv, *first;
+  size_t size;
+  int i, t, start;
+  bool same;
+
+  size = 0;
+  start = -1;
+  first = NULL;
+  same = true;
+
+  for (i=0; i<=count; i++) {
+    tlv = NULL;
+    if (i < count) {
+      for (t=0; t<entries[i].tlv_count; t++) {
+        if (entries[i].tlv[t].type == type && entries[i].tlv[t].ext == ext) {
+          tlv = &entries[i].tlv[t];
+          break;
+        }
+      }
+    }
+
+    if (tlv != NULL && start == -1) {
+      start = i;
+      first = tlv;
+      same = true;
+      continue;
+    }
+    if (tlv != NULL) {
+      same = same && tlv->value == first->value;
+      continue;
+    }
+    if (start == -1) {
+      continue;
+    }
+
+    /* end of run: type, flags, extension, index, length and value(s) */
+    size += 2 + (ext ? 1 : 0);
+    if (start > 0 || i < count) {
+      size += (i - start == 1) ? 1 : 2;
+    }
+    size += 1;
+    size += same ? first->length : (size_t)(i - start) * first->length;
+    start = -1;
+  }
+  return size;
+}
+
+/**
+ * Callback for qsort to order TC addresses the same way as the
+ * olsrv2 writer: network part (/16 or /48), TLV values, address.
+ * @param p1 pointer to first entry
+ * @param p2 pointer to second entry
+ * @return <0, 0 or >0 like memcmp()
+ */
+static int
+_cb_compare_entry(const void *p1, const void *p2) {
+  const struct _size_entry *e1 = p1, *e2 = p2;
+  int result;
+
+  result = nhdp_address_group_compare(
+      e1->addr.family, e1->addr.prefix_len, e1->addr.addr,
+      e2->addr.family, e2->addr.prefix_len, e2->addr.addr,
+      e1->addr.family == AF_INET ? 4 : 16);
+  if (result != 0) {
+    return result;
+  }
+
+  result = memcmp(e1->tlv, e2->tlv, sizeof(e1->tlv));
+  if (result != 0) {
+    return result;
+  }
+  return memcmp(e1->addr.addr, e2->addr.addr, sizeof(e1->addr.addr));
+}
@@ -0,0 +1,470 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * Standalone tool to inspect topology snapshot files written by the
+ * tc_snapshot plugin, to benchmark shortest path calculations on
+ * recorded topologies and to compare TC sizes with different address
+ * orders. It does not link the OONF framework, it only uses its RFC5444
+ * constants and the address order of the writers from header files.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tc_snapshot/tc_snapshot_format.h"
+#include "tc_snapshot/tc_snapshot_size.h"
+
+/* same value as RFC5444_METRIC_INFINITE, such edges cannot be used */
+#define METRIC_INFINITE 0xffffff
+
+/* adjacency list of the topology in compressed row format */
+struct _graph {
+  uint32_t node_count;
+  uint32_t *first_edge;
+  uint32_t *edge_dst;
+  uint32_t *edge_cost;
+};
+
+/* binary heap for dijkstra */
+struct _heap {
+  uint32_t *node;
+  uint32_t *pos;
+  uint64_t *dist;
+  uint32_t count;
+};
+
+static const char *_addr_to_string(char *buf, size_t len,
+    const struct tc_snapshot_addr *addr);
+static void _dump(const struct tc_snapshot_header *hdr);
+static bool _is_usable(const struct tc_snapshot_header *hdr,
+    const struct tc_snapshot_edge *edge, int slot);
+static int _build_graph(struct _graph *graph,
+    const struct tc_snapshot_header *hdr, int slot);
+static uint32_t _dijkstra(struct _graph *graph, struct _heap *heap,
+    uint32_t src);
+static void _heap_push(struct _heap *heap, uint32_t node, uint64_t dist);
+static uint32_t _heap_pop(struct _heap *heap);
+
+static const char *_usage =
+    "Usage: %s [-d] [-z] [-b runs] [-s slot] snapshot-file\n"
+    "  -d        dump all records of the snapshot\n"
+    "  -z        compare TC address block sizes in database and planned order\n"
+    "  -b runs   run the given number of SPF calculations\n"
+    "  -s slot   domain slot used for link costs (default 0)\n";
+
+int
+main(int argc, char **argv) {
+  const struct tc_snapshot_header *hdr;
+  struct _graph graph;
+  struct _heap heap;
+  struct timespec start, end;
+  struct stat st;
+  bool dump, size;
+  long runs, i;
+  int opt, slot, fd;
+  uint64_t reached;
+  double usec;
+  void *map;
+
+  dump = false;
+  size = false;
+  runs = 0;
+  slot = 0;
+
+  while ((opt = getopt(argc, argv, "dzb:s:")) != -1) {
+    switch (opt) {
+      case 'd':
+        dump = true;
+        break;
+      case 'z':
+        size = true;
+        break;
+      case 'b':
+        runs = strtol(optarg, NULL, 10);
+        break;
+      case 's':
+        slot = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, _usage, argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind >= argc || slot < 0 || slot >= TC_SNAPSHOT_MAX_DOMAINS) {
+    fprintf(stderr, _usage, argv[0]);
+    return 1;
+  }
+
+  fd = open(argv[optind], O_RDONLY);
+  if (fd == -1 || fstat(fd, &st)) {
+    fprintf(stderr, "Cannot open %s: %s\n", argv[optind], strerror(errno));
+    return 1;
+  }
+  if ((size_t)st.st_size < sizeof(*hdr)) {
+    fprintf(stderr, "File %s is too short\n", argv[optind]);
+    return 1;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Cannot map %s: %s\n", argv[optind], strerror(errno));
+    return 1;
+  }
+
+  hdr = map;
+  if (memcmp(hdr->magic, TC_SNAPSHOT_MAGIC, sizeof(hdr->magic)) != 0) {
+    fprintf(stderr, "File %s is no topology snapshot\n", argv[optind]);
+    return 1;
+  }
+  if (hdr->version != TC_SNAPSHOT_VERSION
+      || hdr->byteorder != TC_SNAPSHOT_BYTEORDER) {
+    fprintf(stderr, "Snapshot version %u or byte order is not supported\n",
+        hdr->version);
+    return 1;
+  }
+  if (tc_snapshot_get_size(hdr) != (uint64_t)st.st_size) {
+    fprintf(stderr, "Snapshot size does not match header\n");
+    return 1;
+  }
+
+  printf("Snapshot taken: %s", ctime(&(time_t){ hdr->timestamp }));
+  printf("Nodes: %u\nEdges: %u\nAttachments: %u\nDomains: %u\n",
+      hdr->node_count, hdr->edge_count, hdr->attachment_count,
+      hdr->domain_count);
+
+  if (dump) {
+    _dump(hdr);
+  }
+
+  if (size) {
+    tc_snapshot_size_benchmark(hdr);
+  }
+
+  if (runs <= 0 || hdr->node_count == 0) {
+    munmap(map, st.st_size);
+    return 0;
+  }
+
+  if (_build_graph(&graph, hdr, slot)) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  heap.node = calloc(hdr->node_count, sizeof(*heap.node));
+  heap.pos = calloc(hdr->node_count, sizeof(*heap.pos));
+  heap.dist = calloc(hdr->node_count, sizeof(*heap.dist));
+  if (!heap.node || !heap.pos || !heap.dist) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  reached = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i=0; i<runs; i++) {
+    reached += _dijkstra(&graph, &heap, i % hdr->node_count);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  usec = (end.tv_sec - start.tv_sec) * 1e6
+      + (end.tv_nsec - start.tv_nsec) / 1e3;
+  printf("SPF runs: %ld\nAverage time per run: %.1f us\n"
+      "Average reachable nodes: %.1f\n",
+      runs, usec / runs, (double)reached / runs);
+
+  free(heap.node);
+  free(heap.pos);
+  free(heap.dist);
+  free(graph.first_edge);
+  free(graph.edge_dst);
+  free(graph.edge_cost);
+  munmap(map, st.st_size);
+  return 0;
+}
+
+/**
+ * Convert a snapshot address into a string
+ * @param buf output buffer
+ * @param len length of output buffer
+ * @param addr snapshot address
+ * @return pointer to output buffer
+ */
+static const char *
+_addr_to_string(char *buf, size_t len, const struct tc_snapshot_addr *addr) {
+  char ip[INET6_ADDRSTRLEN];
+
+  if (inet_ntop(addr->family, addr->addr, ip, sizeof(ip)) == NULL) {
+    snprintf(buf, len, "-");
+  }
+  else {
+    snprintf(buf, len, "%s/%u", ip, addr->prefix_len);
+  }
+  return buf;
+}
+
+/**
+ * Print all records of a snapshot
+ * @param hdr pointer to snapshot header
+ */
+static void
+_dump(const struct tc_snapshot_header *hdr) {
+  const struct tc_snapshot_node *nodes;
+  const struct tc_snapshot_edge *edge;
+  const struct tc_snapshot_attachment *attached;
+  char buf1[INET6_ADDRSTRLEN + 4], buf2[INET6_ADDRSTRLEN + 4];
+  uint32_t i;
+  int d;
+
+  nodes = tc_snapshot_get_nodes(hdr);
+  for (i=0; i<hdr->node_count; i++) {
+    printf("node %u: %s ansn=%u interval=%ums%s\n", i,
+        _addr_to_string(buf1, sizeof(buf1), &nodes[i].originator),
+        nodes[i].ansn, nodes[i].interval_time,
+        (nodes[i].flags & TC_SNAPSHOT_NODE_VIRTUAL) ? " virtual" : "");
+  }
+
+  edge = tc_snapshot_get_edges(hdr);
+  for (i=0; i<hdr->edge_count; i++, edge++) {
+    if (edge->src >= hdr->node_count || edge->dst >= hdr->node_count) {
+      printf("edge %u: invalid node index\n", i);
+      continue;
+    }
+    printf("edge %s -> %s ansn=%u cost=",
+        _addr_to_string(buf1, sizeof(buf1), &nodes[edge->src].originator),
+        _addr_to_string(buf2, sizeof(buf2), &nodes[edge->dst].originator),
+        edge->ansn);
+    for (d=0; d<(int)hdr->domain_count; d++) {
+      printf("%s%u", d ? "," : "", edge->cost[d]);
+    }
+    printf("\n");
+  }
+
+  attached = tc_snapshot_get_attachments(hdr);
+  for (i=0; i<hdr->attachment_count; i++, attached++) {
+    if (attached->src >= hdr->node_count) {
+      printf("attachment %u: invalid node index\n", i);
+      continue;
+    }
+    printf("%s %s -> %s ansn=%u cost=",
+        attached->type == TC_SNAPSHOT_ADDRESS ? "address" : "network",
+        _addr_to_string(buf1, sizeof(buf1), &nodes[attached->src].originator),
+        _addr_to_string(buf2, sizeof(buf2), &attached->prefix),
+        attached->ansn);
+    for (d=0; d<(int)hdr->domain_count; d++) {
+      printf("%s%u/%u", d ? "," : "", attached->cost[d], attached->distance[d]);
+    }
+    printf("\n");
+  }
+}
+
+/**
+ * @param hdr pointer to snapshot header
+ * @param edge pointer to edge record
+ * @param slot domain slot used for edge costs
+ * @return true if edge can be used for SPF calculation
+ */
+static bool
+_is_usable(const struct tc_snapshot_header *hdr,
+    const struct tc_snapshot_edge *edge, int slot) {
+  return edge->src < hdr->node_count && edge->dst < hdr->node_count
+      && edge->cost[slot] < METRIC_INFINITE;
+}
+
+/**
+ * Convert the edge records of a snapshot into an adjacency list
+ * @param graph pointer to graph
+ * @param hdr pointer to snapshot header
+ * @param slot domain slot used for edge costs
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int
+_build_graph(struct _graph *graph, const struct tc_snapshot_header *hdr,
+    int slot) {
+  const struct tc_snapshot_edge *edges;
+  uint32_t *fill;
+  uint32_t i, idx;
+
+  edges = tc_snapshot_get_edges(hdr);
+
+  graph->node_count = hdr->node_count;
+  graph->first_edge = calloc(hdr->node_count + 1, sizeof(uint32_t));
+  graph->edge_dst = calloc(hdr->edge_count + 1, sizeof(uint32_t));
+  graph->edge_cost = calloc(hdr->edge_count + 1, sizeof(uint32_t));
+  fill = calloc(hdr->node_count, sizeof(uint32_t));
+  if (!graph->first_edge || !graph->edge_dst || !graph->edge_cost || !fill) {
+    free(fill);
+    return -1;
+  }
+
+  for (i=0; i<hdr->edge_count; i++) {
+    if (_is_usable(hdr, &edges[i], slot)) {
+      graph->first_edge[edges[i].src + 1]++;
+    }
+  }
+  for (i=0; i<hdr->node_count; i++) {
+    graph->first_edge[i + 1] += graph->first_edge[i];
+  }
+
+  for (i=0; i<hdr->edge_count; i++) {
+    if (!_is_usable(hdr, &edges[i], slot)) {
+      continue;
+    }
+    idx = graph->first_edge[edges[i].src] + fill[edges[i].src]++;
+    graph->edge_dst[idx] = edges[i].dst;
+    graph->edge_cost[idx] = edges[i].cost[slot];
+  }
+
+  free(fill);
+  return 0;
+}
+
+/**
+ * Run a dijkstra calculation over the graph
+ * @param graph pointer to graph
+ * @param heap pointer to preallocated heap
+ * @param src index of source node
+ * @return number of reachable nodes
+ */
+static uint32_t
+_dijkstra(struct _graph *graph, struct _heap *heap, uint32_t src) {
+  uint64_t dist;
+  uint32_t reached, node, i, dst;
+
+  for (i=0; i<graph->node_count; i++) {
+    heap->dist[i] = UINT64_MAX;
+    heap->pos[i] = UINT32_MAX;
+  }
+  heap->count = 0;
+  reached = 0;
+
+  _heap_push(heap, src, 0);
+  while (heap->count > 0) {
+    node = _heap_pop(heap);
+    reached++;
+
+    for (i=graph->first_edge[node]; i<graph->first_edge[node+1]; i++) {
+      dst = graph->edge_dst[i];
+      dist = heap->dist[node] + graph->edge_cost[i];
+
+      if (dist < heap->dist[dst]) {
+        _heap_push(heap, dst, dist);
+      }
+    }
+  }
+  return reached;
+}
+
+/**
+ * Add a node to the heap or decrease its distance
+ * @param heap pointer to heap
+ * @param node node index
+ * @param dist new distance of node
+ */
+static void
+_heap_push(struct _heap *heap, uint32_t node, uint64_t dist) {
+  uint32_t idx, parent;
+
+  heap->dist[node] = dist;
+
+  idx = heap->pos[node];
+  if (idx == UINT32_MAX) {
+    idx = heap->count++;
+  }
+
+  while (idx > 0) {
+    parent = (idx - 1) / 2;
+    if (heap->dist[heap->node[parent]] <= dist) {
+      break;
+    }
+    heap->node[idx] = heap->node[parent];
+    heap->pos[heap->node[idx]] = idx;
+    idx = parent;
+  }
+  heap->node[idx] = node;
+  heap->pos[node] = idx;
+}
+
+/**
+ * Remove the node with the smallest distance from the heap
+ * @param heap pointer to heap
+ * @return index of node
+ */
+static uint32_t
+_heap_pop(struct _heap *heap) {
+  uint32_t result, last, idx, child;
+
+  result = heap->node[0];
+  /* mark node as finished, it will never enter the heap again */
+  heap->pos[result] = UINT32_MAX - 1;
+
+  last = heap->node[--heap->count];
+  idx = 0;
+  while ((child = 2 * idx + 1) < heap->count) {
+    if (child + 1 < heap->count
+        && heap->dist[heap->node[child + 1]] < heap->dist[heap->node[child]]) {
+      child++;
+    }
+    if (heap->dist[last] <= heap->dist[heap->node[child]]) {
+      break;
+    }
+    heap->node[idx] = heap->node[child];
+    heap->pos[heap->node[idx]] = idx;
+    idx = child;
+  }
+  if (heap->count > 0) {
+    heap->node[idx] = last;
+    heap->pos[last] = idx;
+  }
+  return result;
+}
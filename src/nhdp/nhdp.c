@@ -98,6 +98,12 @@ static struct cfg_schema_entry _interface_entries[] = {
     "Validity time for NHDP Hello Messages", 100),
   CFG_MAP_CLOCK_MIN(nhdp_interface, refresh_interval, "hello-interval", "2.0",
     "Time interval between two NHDP Hello Messages", 100),
+  CFG_MAP_CLOCK(nhdp_interface, refresh_max_interval, "hello-max-interval", "0",
+    "Maximum time between two NHDP Hello Messages if all links of the interface"
+    " are stable. Values up to hello-interval disable the adaptive interval."
+    " The validity time of Hellos is scaled with the current interval, so a"
+    " larger maximum saves Hellos on stable links but delays the detection"
+    " of a lost link by the same factor."),
 };
 
 static struct cfg_schema_section _interface_section = {
@@ -175,16 +181,21 @@ _init(void) {
     return -1;
   }
 
-  if (nhdp_writer_init(_protocol)) {
-    oonf_rfc5444_remove_protocol(_protocol);
-    return -1;
-  }
-
   nhdp_db_init();
   nhdp_reader_init(_protocol);
   nhdp_interfaces_init(_protocol);
   nhdp_domain_init(_protocol);
 
+  /* the writer hooks into the database classes for its HELLO cache */
+  if (nhdp_writer_init(_protocol)) {
+    nhdp_reader_cleanup();
+    nhdp_db_cleanup();
+    nhdp_interfaces_cleanup();
+    nhdp_domain_cleanup();
+    oonf_rfc5444_remove_protocol(_protocol);
+    return -1;
+  }
+
   for (i=0; i<ARRAYSIZE(_cmds); i++) {
     oonf_telnet_add(&_cmds[i]);
   }
@@ -545,8 +556,9 @@ _telnet_nhdp_iflink(struct oonf_telnet_data *con) {
 
     abuf_appendf(con->out, "Interface '%s': hello_interval=%s hello_vtime=%s\n",
         nhdp_interface_get_name(interf),
-        oonf_clock_toIntervalString(&tbuf1, interf->refresh_interval),
-        oonf_clock_toIntervalString(&tbuf2, interf->h_hold_time));
+        oonf_clock_toIntervalString(&tbuf1, interf->hello_interval),
+        oonf_clock_toIntervalString(&tbuf2,
+            nhdp_interface_get_hello_validity(interf)));
 
     avl_for_each_element(&interf->_if_addresses, addr, _if_node) {
       if (!addr->removed) {
@@ -572,13 +584,24 @@ _telnet_nhdp_interface(struct oonf_telnet_data *con) {
   struct nhdp_interface_addr *addr;
   struct isonumber_str tbuf1, tbuf2;
   struct netaddr_str nbuf;
+  uint64_t ratio;
 
   avl_for_each_element(&nhdp_interface_tree, interf, _node) {
 
     abuf_appendf(con->out, "Interface '%s': hello_interval=%s hello_vtime=%s\n",
         nhdp_interface_get_name(interf),
-        oonf_clock_toIntervalString(&tbuf1, interf->refresh_interval),
-        oonf_clock_toIntervalString(&tbuf2, interf->h_hold_time));
+        oonf_clock_toIntervalString(&tbuf1, interf->hello_interval),
+        oonf_clock_toIntervalString(&tbuf2,
+            nhdp_interface_get_hello_validity(interf)));
+    ratio = 0;
+    if (interf->packets_sent > 0) {
+      ratio = (uint64_t)interf->messages_sent * 100 / interf->packets_sent;
+    }
+    abuf_appendf(con->out, "\tPackets: %u Messages: %u (%u.%02u per packet)"
+        " Aggregated HELLOs: %u\n",
+        interf->packets_sent, interf->messages_sent,
+        (unsigned)(ratio / 100), (unsigned)(ratio % 100),
+        interf->hellos_aggregated);
 
     avl_for_each_element(&interf->_if_addresses, addr, _if_node) {
       if (!addr->removed) {
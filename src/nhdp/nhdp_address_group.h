@@ -0,0 +1,89 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef NHDP_ADDRESS_GROUP_H_
+#define NHDP_ADDRESS_GROUP_H_
+
+#include <string.h>
+
+#include "common/common_types.h"
+
+/*
+ * The comparator works on the binary address only, so the tc_snapshot
+ * tool can share the address order of the writers without linking
+ * the OONF framework.
+ */
+
+/**
+ * Compare the address family, the prefix length and the network part
+ * (/16 for IPv4, /48 for IPv6) of two addresses. RFC5444 writers use
+ * this as the primary sort key for their addresses, so addresses with a
+ * common head end up next to each other and can share an address block.
+ * @param af1 address family of first address
+ * @param prefix_len1 prefix length of first address
+ * @param bin1 pointer to binary first address
+ * @param af2 address family of second address
+ * @param prefix_len2 prefix length of second address
+ * @param bin2 pointer to binary second address
+ * @param bin_len length of the binary addresses
+ * @return <0, 0 or >0 like memcmp()
+ */
+static INLINE int
+nhdp_address_group_compare(int af1, uint8_t prefix_len1, const void *bin1,
+    int af2, uint8_t prefix_len2, const void *bin2, size_t bin_len) {
+  size_t len;
+
+  if (af1 != af2) {
+    return af1 - af2;
+  }
+  if (prefix_len1 != prefix_len2) {
+    return (int)prefix_len1 - (int)prefix_len2;
+  }
+
+  /* first half of the address, but not more than a /48 */
+  len = bin_len / 2;
+  if (len > 6) {
+    len = 6;
+  }
+  return memcmp(bin1, bin2, len);
+}
+
+#endif /* NHDP_ADDRESS_GROUP_H_ */
@@ -60,6 +60,8 @@
 /* Prototypes of local functions */
 static void _link_status_now_symmetric(struct nhdp_link *lnk);
 static void _link_status_not_symmetric_anymore(struct nhdp_link *lnk);
+static struct nhdp_2hop *_2hop_add(const struct netaddr *addr);
+static void _2hop_remove(struct nhdp_2hop *twohop);
 int _nhdp_db_link_calculate_status(struct nhdp_link *lnk);
 
 static void _cb_link_vtime(void *);
@@ -68,7 +70,13 @@ static void _cb_link_symtime(void *);
 static void _cb_l2hop_vtime(void *);
 static void _cb_naddr_vtime(void *);
 
-/* memory and timer classes necessary for NHDP */
+/*
+ * memory and timer classes necessary for NHDP
+ *
+ * Links and addresses come and go with the neighborhood, so the classes
+ * keep a number of freed objects for reuse instead of going back to
+ * the system allocator for every HELLO that changes the database.
+ */
 static struct oonf_class _neigh_info = {
   .name = NHDP_CLASS_NEIGHBOR,
   .size = sizeof(struct nhdp_neighbor),
@@ -77,21 +85,30 @@ static struct oonf_class _neigh_info = {
 static struct oonf_class _link_info = {
   .name = NHDP_CLASS_LINK,
   .size = sizeof(struct nhdp_link),
+  .min_free_count = 16,
 };
 
 static struct oonf_class _laddr_info = {
   .name = NHDP_CLASS_LINK_ADDRESS,
   .size = sizeof(struct nhdp_laddr),
+  .min_free_count = 64,
 };
 
 static struct oonf_class _l2hop_info = {
   .name = NHDP_CLASS_LINK_2HOP,
   .size = sizeof(struct nhdp_l2hop),
+  .min_free_count = 256,
+};
+
+static struct oonf_class _2hop_info = {
+  .name = NHDP_CLASS_2HOP,
+  .size = sizeof(struct nhdp_2hop),
 };
 
 static struct oonf_class _naddr_info = {
   .name = NHDP_CLASS_NEIGHBOR_ADDRESS,
   .size = sizeof(struct nhdp_naddr),
+  .min_free_count = 64,
 };
 
 static struct oonf_timer_info _link_vtime_info = {
@@ -131,6 +148,9 @@ struct avl_tree nhdp_neigh_originator_tree;
 /* list of links (to neighbors) */
 struct list_entity nhdp_link_list;
 
+/* global tree of two-hop addresses */
+struct avl_tree nhdp_2hop_tree;
+
 /**
  * Initialize NHDP databases
  */
@@ -140,12 +160,14 @@ nhdp_db_init(void) {
   list_init_head(&nhdp_neigh_list);
   avl_init(&nhdp_neigh_originator_tree, avl_comp_netaddr, false);
   list_init_head(&nhdp_link_list);
+  avl_init(&nhdp_2hop_tree, avl_comp_netaddr, false);
 
   oonf_class_add(&_neigh_info);
   oonf_class_add(&_naddr_info);
   oonf_class_add(&_link_info);
   oonf_class_add(&_laddr_info);
   oonf_class_add(&_l2hop_info);
+  oonf_class_add(&_2hop_info);
 
   oonf_timer_add(&_naddr_vtime_info);
   oonf_timer_add(&_link_vtime_info);
@@ -174,6 +196,7 @@ nhdp_db_cleanup(void) {
   oonf_timer_remove(&_naddr_vtime_info);
 
   /* cleanup all memory cookies */
+  oonf_class_remove(&_2hop_info);
   oonf_class_remove(&_l2hop_info);
   oonf_class_remove(&_laddr_info);
   oonf_class_remove(&_link_info);
@@ -246,6 +269,11 @@ nhdp_db_neighbor_remove(struct nhdp_neighbor *neigh) {
     avl_remove(&nhdp_neigh_originator_tree, &neigh->_originator_node);
   }
 
+  /* remove from list of neighbors waiting for a metric update */
+  if (list_is_node_added(&neigh->_dirty_node)) {
+    list_remove(&neigh->_dirty_node);
+  }
+
   /* remove from global list and free memory */
   list_remove(&neigh->_global_node);
   oonf_class_free(&_neigh_info, neigh);
@@ -376,6 +404,41 @@ nhdp_db_neighbor_addr_move(struct nhdp_neighbor *neigh, struct nhdp_naddr *naddr
 
   /* set new backlink */
   naddr->neigh = neigh;
+
+  /* trigger change event */
+  oonf_class_event(&_naddr_info, naddr, OONF_OBJECT_CHANGED);
+}
+
+/**
+ * Define a neighbor address as lost
+ * @param naddr nhdp neighbor address
+ * @param vtime time until lost address gets purged from the database
+ */
+void
+nhdp_db_neighbor_addr_set_lost(struct nhdp_naddr *naddr, uint64_t vtime) {
+  bool was_lost;
+
+  was_lost = oonf_timer_is_active(&naddr->_lost_vtime);
+  oonf_timer_set(&naddr->_lost_vtime, vtime);
+
+  if (!was_lost) {
+    /* trigger change event */
+    oonf_class_event(&_naddr_info, naddr, OONF_OBJECT_CHANGED);
+  }
+}
+
+/**
+ * Define a neighbor address as not lost anymore
+ * @param naddr nhdp neighbor address
+ */
+void
+nhdp_db_neighbor_addr_not_lost(struct nhdp_naddr *naddr) {
+  if (oonf_timer_is_active(&naddr->_lost_vtime)) {
+    oonf_timer_stop(&naddr->_lost_vtime);
+
+    /* trigger change event */
+    oonf_class_event(&_naddr_info, naddr, OONF_OBJECT_CHANGED);
+  }
 }
 
 /**
@@ -509,6 +572,9 @@ nhdp_db_link_add(struct nhdp_neighbor *neigh, struct nhdp_interface *local_if) {
   /* initialize link domain data */
   nhdp_domain_init_link(lnk);
 
+  /* answer new neighbor with the fast hello interval */
+  nhdp_interface_trigger_hello(local_if);
+
   /* trigger event */
   oonf_class_event(&_link_info, lnk, OONF_OBJECT_ADDED);
 
@@ -531,6 +597,9 @@ nhdp_db_link_remove(struct nhdp_link *lnk) {
     _link_status_not_symmetric_anymore(lnk);
   }
 
+  /* announce the lost link with the fast hello interval */
+  nhdp_interface_trigger_hello(lnk->local_if);
+
   /* stop link timers */
   oonf_timer_stop(&lnk->sym_time);
   oonf_timer_stop(&lnk->heard_time);
@@ -636,6 +705,9 @@ nhdp_db_link_addr_move(struct nhdp_link *lnk, struct nhdp_laddr *laddr) {
   }
   /* set new backlink */
   laddr->link = lnk;
+
+  /* trigger change event */
+  oonf_class_event(&_laddr_info, laddr, OONF_OBJECT_CHANGED);
 }
 
 /**
@@ -653,6 +725,15 @@ nhdp_db_link_2hop_add(struct nhdp_link *lnk, const struct netaddr *addr) {
     return NULL;
   }
 
+  l2hop->twohop = nhdp_db_2hop_get(addr);
+  if (l2hop->twohop == NULL) {
+    l2hop->twohop = _2hop_add(addr);
+    if (l2hop->twohop == NULL) {
+      oonf_class_free(&_l2hop_info, l2hop);
+      return NULL;
+    }
+  }
+
   /* initialize key */
   memcpy(&l2hop->twohop_addr, addr, sizeof(l2hop->twohop_addr));
   l2hop->_link_node.key = &l2hop->twohop_addr;
@@ -666,9 +747,12 @@ nhdp_db_link_2hop_add(struct nhdp_link *lnk, const struct netaddr *addr) {
 
   /* add to trees */
   avl_insert(&lnk->_2hop, &l2hop->_link_node);
+  list_add_tail(&l2hop->twohop->_l2hops, &l2hop->_2hop_node);
+  l2hop->twohop->l2hop_count++;
 
   /* initialize metrics */
   nhdp_domain_init_l2hop(l2hop);
+  nhdp_domain_recalculate_2hop(l2hop->twohop);
 
   /* trigger event */
   oonf_class_event(&_l2hop_info, l2hop, OONF_OBJECT_ADDED);
@@ -687,6 +771,15 @@ nhdp_db_link_2hop_remove(struct nhdp_l2hop *l2hop) {
 
   /* remove from tree */
   avl_remove(&l2hop->link->_2hop, &l2hop->_link_node);
+  list_remove(&l2hop->_2hop_node);
+
+  /* update global two-hop address */
+  if (--l2hop->twohop->l2hop_count == 0) {
+    _2hop_remove(l2hop->twohop);
+  }
+  else {
+    nhdp_domain_recalculate_2hop(l2hop->twohop);
+  }
 
   /* stop validity timer */
   oonf_timer_stop(&l2hop->_vtime);
@@ -734,12 +827,17 @@ nhdp_db_link_disconnect_dualstack(struct nhdp_link *lnk) {
  */
 void
 nhdp_db_link_update_status(struct nhdp_link *lnk) {
+  enum nhdp_link_status old_status;
   bool was_symmetric;
 
+  old_status = lnk->status;
   was_symmetric = lnk->status == NHDP_LINK_SYMMETRIC;
 
   /* update link status */
   lnk->status = _nhdp_db_link_calculate_status(lnk);
+  if (lnk->status != old_status) {
+    nhdp_interface_trigger_hello(lnk->local_if);
+  }
 
   /* handle database changes */
   if (was_symmetric && lnk->status != NHDP_LINK_SYMMETRIC) {
@@ -793,6 +891,51 @@ _link_status_now_symmetric(struct nhdp_link *lnk) {
   }
 }
 
+/**
+ * Add a new address to the global two-hop address tree
+ * @param addr network address
+ * @return global two-hop address, NULL if out of memory
+ */
+static struct nhdp_2hop *
+_2hop_add(const struct netaddr *addr) {
+  struct nhdp_2hop *twohop;
+
+  twohop = oonf_class_malloc(&_2hop_info);
+  if (twohop == NULL) {
+    return NULL;
+  }
+
+  /* initialize key */
+  memcpy(&twohop->twohop_addr, addr, sizeof(twohop->twohop_addr));
+  twohop->_global_node.key = &twohop->twohop_addr;
+
+  list_init_head(&twohop->_l2hops);
+
+  /* add to global tree */
+  avl_insert(&nhdp_2hop_tree, &twohop->_global_node);
+
+  /* trigger event */
+  oonf_class_event(&_2hop_info, twohop, OONF_OBJECT_ADDED);
+
+  return twohop;
+}
+
+/**
+ * Remove an address without links from the global two-hop address tree
+ * @param twohop global two-hop address
+ */
+static void
+_2hop_remove(struct nhdp_2hop *twohop) {
+  /* trigger event */
+  oonf_class_event(&_2hop_info, twohop, OONF_OBJECT_REMOVED);
+
+  /* remove from tree */
+  avl_remove(&nhdp_2hop_tree, &twohop->_global_node);
+
+  /* free memory */
+  oonf_class_free(&_2hop_info, twohop);
+}
+
 /**
  * Helper function that handles the case of a link becoming asymmetric
  * @param lnk nhdp link
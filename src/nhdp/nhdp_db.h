@@ -54,6 +54,7 @@
 #define NHDP_CLASS_LINK             "nhdp_link"
 #define NHDP_CLASS_LINK_ADDRESS     "nhdp_laddr"
 #define NHDP_CLASS_LINK_2HOP        "nhdp_l2hop"
+#define NHDP_CLASS_2HOP             "nhdp_2hop"
 #define NHDP_CLASS_NEIGHBOR         "nhdp_neighbor"
 #define NHDP_CLASS_NEIGHBOR_ADDRESS "nhdp_naddr"
 
@@ -113,27 +114,36 @@ struct nhdp_l2hop_domaindata {
   struct nhdp_metric metric;
 };
 
+/**
+ * Data for one NHDP domain of a two-hop address
+ */
+struct nhdp_2hop_domaindata {
+  /* best path cost through any one-hop neighbor */
+  struct nhdp_metric metric;
+
+  /* neighbor with the best outgoing path cost, NULL if none */
+  struct nhdp_neighbor *best_neigh;
+};
+
 /**
  * nhdl_link represents a link by a specific local interface to one interface
  * of a one-hop neighbor.
+ *
+ * The fields used by the metric, MPR and routing loops are grouped at the
+ * start of the struct, bookkeeping only used when a HELLO is processed or
+ * a timer fires is placed behind them. The per-domain data is a class
+ * extension (see nhdp_domain_get_linkdata()), so it is appended behind
+ * the struct and not part of this grouping.
  */
 struct nhdp_link {
-  /* last received validity time */
-  uint64_t vtime_value;
-
-  /* last received interval time */
-  uint64_t itime_value;
-  /* timer that fires if this link is not symmetric anymore */
-  struct oonf_timer_entry sym_time;
-
-  /* timer that fires if the last received neighbor HELLO timed out */
-  struct oonf_timer_entry heard_time;
+  /* member entry for nhdp links of local interface */
+  struct list_entity _if_node;
 
-  /* timer that fires when the link has to be removed from the database */
-  struct oonf_timer_entry vtime;
+  /* member entry for nhdp links of neighbor node */
+  struct list_entity _neigh_node;
 
-  /* cached status of the linked */
-  enum nhdp_link_status status;
+  /* pointer to neighbor entry of the other side of the link */
+  struct nhdp_neighbor *neigh;
 
   /* pointer to local interface for this link */
   struct nhdp_interface *local_if;
@@ -141,38 +151,44 @@ struct nhdp_link {
   /* pointer to other (dualstack) representation of this link */
   struct nhdp_link *dualstack_partner;
 
-  /* pointer to neighbor entry of the other side of the link */
-  struct nhdp_neighbor *neigh;
-
-  /* local interface address heard from the link */
-  struct netaddr if_addr;
-
-  /* mac address of remote link end */
-  struct netaddr remote_mac;
+  /* cached status of the linked */
+  enum nhdp_link_status status;
 
   /* internal field for NHDP processing */
   int _process_count;
 
-  /* tree of local addresses of the other side of the link */
-  struct avl_tree _addresses;
-
   /* tree of two-hop addresses reachable through the other side of the link */
   struct avl_tree _2hop;
 
+  /* tree of local addresses of the other side of the link */
+  struct avl_tree _addresses;
+
   /* member entry for global list of nhdp links */
   struct list_entity _global_node;
 
-  /* member entry for nhdp links of local interface */
-  struct list_entity _if_node;
-
-  /* member entry for nhdp links of neighbor node */
-  struct list_entity _neigh_node;
-
   /* optional member node for interface tree of originators */
   struct avl_node _originator_node;
 
-  /* Array of link metrics */
-  struct nhdp_link_domaindata _domaindata[NHDP_MAXIMUM_DOMAINS];
+  /* last received validity time */
+  uint64_t vtime_value;
+
+  /* last received interval time */
+  uint64_t itime_value;
+
+  /* local interface address heard from the link */
+  struct netaddr if_addr;
+
+  /* mac address of remote link end */
+  struct netaddr remote_mac;
+
+  /* timer that fires if this link is not symmetric anymore */
+  struct oonf_timer_entry sym_time;
+
+  /* timer that fires if the last received neighbor HELLO timed out */
+  struct oonf_timer_entry heard_time;
+
+  /* timer that fires when the link has to be removed from the database */
+  struct oonf_timer_entry vtime;
 };
 
 /**
@@ -182,20 +198,20 @@ struct nhdp_laddr {
   /* links interface address */
   struct netaddr link_addr;
 
+  /* internal variable for NHDP processing */
+  bool _might_be_removed;
+
   /* link entry for address */
   struct nhdp_link *link;
 
-  /* internal variable for NHDP processing */
-  bool _might_be_removed;
+  /* member entry for interface tree of link addresses */
+  struct avl_node _if_node;
 
   /* member entry for addresses of neighbor link */
   struct avl_node _link_node;
 
   /* member entry for addresss of neighbor */
   struct avl_node _neigh_node;
-
-  /* member entry for interface tree of link addresses */
-  struct avl_node _if_node;
 };
 
 /**
@@ -208,26 +224,60 @@ struct nhdp_l2hop {
   /* link entry for two-hop address */
   struct nhdp_link *link;
 
-  /* validity time for this address */
-  struct oonf_timer_entry _vtime;
+  /* global two-hop address entry */
+  struct nhdp_2hop *twohop;
 
   /* member entry for two-hop addresses of neighbor link */
   struct avl_node _link_node;
 
-  /* Array of link metrics */
-  struct nhdp_l2hop_domaindata _domaindata[NHDP_MAXIMUM_DOMAINS];
+  /* member entry for links of global two-hop address */
+  struct list_entity _2hop_node;
+
+  /* validity time for this address */
+  struct oonf_timer_entry _vtime;
+};
+
+/**
+ * nhdp_2hop represents a two-hop address reachable through
+ * one or more links
+ */
+struct nhdp_2hop {
+  /* address of two-hop neighbor */
+  struct netaddr twohop_addr;
+
+  /* number of links the address is reachable through */
+  uint32_t l2hop_count;
+
+  /* list of link two-hop entries of this address */
+  struct list_entity _l2hops;
+
+  /* member entry for global two-hop address tree */
+  struct avl_node _global_node;
 };
 
 /**
  * nhdp_neighbor represents a neighbor node (with one or multiple interfaces
+ *
+ * Like in nhdp_link the fields used by the metric, MPR and routing loops
+ * are grouped at the start of the struct, the per-domain data is a class
+ * extension behind it.
  */
 struct nhdp_neighbor {
-  /* originator address of this node, might by type AF_UNSPEC */
-  struct netaddr originator;
+  /* member entry for global list of neighbors */
+  struct list_entity _global_node;
+
+  /* list of links for this neighbor */
+  struct list_entity _links;
+
+  /* member entry for list of neighbors with changed link metrics */
+  struct list_entity _dirty_node;
 
   /* number of links to this neighbor which are symmetric */
   int symmetric;
 
+  /* internal field for NHDP processing */
+  int _process_count;
+
   /* pointer to other (dualstack) representation of this neighbor */
   struct nhdp_neighbor *dualstack_partner;
 
@@ -240,11 +290,8 @@ struct nhdp_neighbor {
   /* Willingness of neighbor for flooding data */
   uint8_t flooding_willingness;
 
-  /* internal field for NHDP processing */
-  int _process_count;
-
-  /* list of links for this neighbor */
-  struct list_entity _links;
+  /* originator address of this node, might by type AF_UNSPEC */
+  struct netaddr originator;
 
   /* tree of addresses of this neighbor */
   struct avl_tree _neigh_addresses;
@@ -252,14 +299,8 @@ struct nhdp_neighbor {
   /* tree of addresses of this neighbors links */
   struct avl_tree _link_addresses;
 
-  /* member entry for global list of neighbors */
-  struct list_entity _global_node;
-
   /* optional member node for global tree of originators */
   struct avl_node _originator_node;
-
-  /* Array of link metrics */
-  struct nhdp_neighbor_domaindata _domaindata[NHDP_MAXIMUM_DOMAINS];
 };
 
 /**
@@ -270,29 +311,30 @@ struct nhdp_naddr {
   /* neighbor interface address */
   struct netaddr neigh_addr;
 
+  /* temporary variables for NHDP Hello processing */
+  bool _this_if, _might_be_removed;
+
   /* backlink to neighbor */
   struct nhdp_neighbor *neigh;
 
   /* link address usage counter */
   int laddr_count;
 
-  /* validity time for this address when its lost */
-  struct oonf_timer_entry _lost_vtime;
+  /* member entry for global neighbor address tree */
+  struct avl_node _global_node;
 
   /* member entry for neighbor address tree */
   struct avl_node _neigh_node;
 
-  /* member entry for global neighbor address tree */
-  struct avl_node _global_node;
-
-  /* temporary variables for NHDP Hello processing */
-  bool _this_if, _might_be_removed;
+  /* validity time for this address when its lost */
+  struct oonf_timer_entry _lost_vtime;
 };
 
 EXPORT extern struct list_entity nhdp_neigh_list;
 EXPORT extern struct list_entity nhdp_link_list;
 EXPORT extern struct avl_tree nhdp_naddr_tree;
 EXPORT extern struct avl_tree nhdp_neigh_originator_tree;
+EXPORT extern struct avl_tree nhdp_2hop_tree;
 
 void nhdp_db_init(void);
 void nhdp_db_cleanup(void);
@@ -303,6 +345,8 @@ EXPORT void nhdp_db_neighbor_join(struct nhdp_neighbor *, struct nhdp_neighbor *
 EXPORT struct nhdp_naddr *nhdp_db_neighbor_addr_add(struct nhdp_neighbor *, const struct netaddr *);
 EXPORT void nhdp_db_neighbor_addr_remove(struct nhdp_naddr *);
 EXPORT void nhdp_db_neighbor_addr_move(struct nhdp_neighbor *, struct nhdp_naddr *);
+EXPORT void nhdp_db_neighbor_addr_set_lost(struct nhdp_naddr *, uint64_t vtime);
+EXPORT void nhdp_db_neighbor_addr_not_lost(struct nhdp_naddr *);
 EXPORT void nhdp_db_neighbor_set_originator(struct nhdp_neighbor *, const struct netaddr *);
 EXPORT void nhdp_db_neighbor_connect_dualstack(struct nhdp_neighbor *, struct nhdp_neighbor *);
 EXPORT void nhdp_db_neigbor_disconnect_dualstack(struct nhdp_neighbor *neigh);
@@ -363,6 +407,16 @@ ndhp_db_link_2hop_get(const struct nhdp_link *lnk, const struct netaddr *addr) {
   return avl_find_element(&lnk->_2hop, addr, l2hop, _link_node);
 }
 
+/**
+ * @param addr network address
+ * @return corresponding global two-hop address, NULL if not found
+ */
+static INLINE struct nhdp_2hop *
+nhdp_db_2hop_get(const struct netaddr *addr) {
+  struct nhdp_2hop *twohop;
+  return avl_find_element(&nhdp_2hop_tree, addr, twohop, _global_node);
+}
+
 /**
  * Sets the validity time of a nhdp link
  * @param lnk pointer to nhdp link
@@ -408,25 +462,6 @@ nhdp_db_link_2hop_set_vtime(
   oonf_timer_set(&l2hop->_vtime, vtime);
 }
 
-/**
- * Define a neighbor address as lost
- * @param naddr nhdp neighbor address
- * @param vtime time until lost address gets purged from the database
- */
-static INLINE void
-nhdp_db_neighbor_addr_set_lost(struct nhdp_naddr *naddr, uint64_t vtime) {
-  oonf_timer_set(&naddr->_lost_vtime, vtime);
-}
-
-/**
- * Define a neighbor address as not lost anymore
- * @param naddr nhdp neighbor address
- */
-static INLINE void
-nhdp_db_neighbor_addr_not_lost(struct nhdp_naddr *naddr) {
-  oonf_timer_stop(&naddr->_lost_vtime);
-}
-
 /**
  * @param naddr nhdp neighbor address
  * @return true if address is lost, false otherwise
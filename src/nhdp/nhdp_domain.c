@@ -61,8 +61,17 @@ static void _apply_metric(struct nhdp_domain *domain, const char *metric_name);
 static void _remove_metric(struct nhdp_domain *);
 static void _apply_mpr(struct nhdp_domain *domain, const char *mpr_name);
 static void _remove_mpr(struct nhdp_domain *);
+static void _update_flooding_mpr(struct nhdp_neighbor *neigh);
+static int _add_domain_data(struct nhdp_domain *domain);
+static void _remove_domain_data(struct nhdp_domain *domain);
+static int _add_extension(struct oonf_class_extension *ext,
+    const char *class_name, size_t size);
 
-static void _recalculate_neighbor_metric(struct nhdp_domain *domain,
+static bool _recalculate_neighbor_metric(struct nhdp_domain *domain,
+    struct nhdp_neighbor *neigh);
+static void _recalculate_2hop_metric(struct nhdp_domain *domain,
+    struct nhdp_2hop *twohop);
+static void _recalculate_neighbor_2hops(struct nhdp_domain *domain,
     struct nhdp_neighbor *neigh);
 static const char *_to_string(struct nhdp_metric_str *, uint32_t);
 
@@ -101,6 +110,12 @@ struct list_entity nhdp_domain_listener_list;
 
 static size_t _domain_counter = 0;
 
+/* neighbors with changed incoming link metrics */
+static struct list_entity _dirty_neighbors;
+
+/* per-domain data registered for other memory classes */
+static struct list_entity _classdata_list;
+
 /* tree of known routing metrics/mpr-algorithms */
 struct avl_tree nhdp_domain_metrics;
 struct avl_tree nhdp_domain_mprs;
@@ -123,6 +138,8 @@ nhdp_domain_init(struct oonf_rfc5444_protocol *p) {
   oonf_class_add(&_domain_class);
   list_init_head(&nhdp_domain_list);
   list_init_head(&nhdp_domain_listener_list);
+  list_init_head(&_dirty_neighbors);
+  list_init_head(&_classdata_list);
 
   avl_init(&nhdp_domain_metrics, avl_comp_strcasecmp, false);
   avl_init(&nhdp_domain_mprs, avl_comp_strcasecmp, false);
@@ -146,6 +163,9 @@ nhdp_domain_cleanup(void) {
     rfc5444_writer_unregister_addrtlvtype(
         &_protocol->writer, &domain->_mpr_addrtlv);
 
+    /* remove domain data from database objects */
+    _remove_domain_data(domain);
+
     /* remove domain */
     list_remove(&domain->_node);
     oonf_class_free(&_domain_class, domain);
@@ -262,7 +282,6 @@ nhdp_domain_mpr_remove(struct nhdp_domain_mpr *mpr) {
   list_for_each_element(&nhdp_domain_list, domain, _node) {
     if (domain->mpr == mpr) {
       _remove_mpr(domain);
-      break;
     }
   }
 
@@ -289,6 +308,52 @@ nhdp_domain_listener_remove(struct nhdp_domain_listener *listener) {
   }
 }
 
+/**
+ * Add per-domain data to the objects of a memory class. This must
+ * be done before the class has allocated objects.
+ * @param data pointer to per-domain class data
+ * @return 0 if successful, -1 if the class could not be extended
+ */
+int
+nhdp_domain_classdata_add(struct nhdp_domain_classdata *data) {
+  struct nhdp_domain *domain, *registered;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    if (_add_extension(&data->_ext[domain->index],
+        data->class_name, data->size)) {
+      /* only the domains before the failed one have been registered */
+      list_for_each_element(&nhdp_domain_list, registered, _node) {
+        if (registered == domain) {
+          break;
+        }
+        oonf_class_extension_remove(&data->_ext[registered->index]);
+      }
+      return -1;
+    }
+  }
+
+  list_add_tail(&_classdata_list, &data->_node);
+  return 0;
+}
+
+/**
+ * Remove per-domain data from the objects of a memory class
+ * @param data pointer to per-domain class data
+ */
+void
+nhdp_domain_classdata_remove(struct nhdp_domain_classdata *data) {
+  struct nhdp_domain *domain;
+
+  if (!list_is_node_added(&data->_node)) {
+    return;
+  }
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    oonf_class_extension_remove(&data->_ext[domain->index]);
+  }
+  list_remove(&data->_node);
+}
+
 /**
  * @param ext TLV extension value of MPR/Linkmetrics
  * @return NHDP domain registered to this extension, NULL if not found
@@ -341,6 +406,20 @@ nhdp_domain_init_l2hop(struct nhdp_l2hop *l2hop) {
   }
 }
 
+/**
+ * Recalculate the best path costs of a global two-hop address
+ * in all domains
+ * @param twohop global NHDP two-hop address
+ */
+void
+nhdp_domain_recalculate_2hop(struct nhdp_2hop *twohop) {
+  struct nhdp_domain *domain;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    _recalculate_2hop_metric(domain, twohop);
+  }
+}
+
 /**
  * Initialize the domain data of a new NHDP neighbor
  * @param neigh NHDP neighbor
@@ -422,19 +501,28 @@ void
 nhdp_domain_neighborhood_changed(void) {
   struct nhdp_domain_listener *listener;
   struct nhdp_domain *domain;
-  struct nhdp_neighbor *neigh;
+  struct nhdp_neighbor *neigh, *n_it;
+  struct nhdp_2hop *twohop;
+
+  /* all neighbors are recalculated anyways */
+  list_for_each_element_safe(&_dirty_neighbors, neigh, _dirty_node, n_it) {
+    list_remove(&neigh->_dirty_node);
+  }
 
   list_for_each_element(&nhdp_domain_list, domain, _node) {
     list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
       _recalculate_neighbor_metric(domain, neigh);
     }
+    avl_for_each_element(&nhdp_2hop_tree, twohop, _global_node) {
+      _recalculate_2hop_metric(domain, twohop);
+    }
 
     if (domain->mpr->update_mpr != NULL) {
-      domain->mpr->update_mpr();
+      domain->mpr->update_mpr(domain, NULL);
     }
   }
 
-  // TODO: flooding mpr ?
+  _update_flooding_mpr(NULL);
 
   list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
     if (listener->update) {
@@ -453,15 +541,20 @@ nhdp_domain_neighbor_changed(struct nhdp_neighbor *neigh) {
   struct nhdp_domain_listener *listener;
   struct nhdp_domain *domain;
 
+  if (list_is_node_added(&neigh->_dirty_node)) {
+    list_remove(&neigh->_dirty_node);
+  }
+
   list_for_each_element(&nhdp_domain_list, domain, _node) {
     _recalculate_neighbor_metric(domain, neigh);
+    _recalculate_neighbor_2hops(domain, neigh);
 
     if (domain->mpr->update_mpr != NULL) {
-      domain->mpr->update_mpr();
+      domain->mpr->update_mpr(domain, neigh);
     }
   }
 
-  // TODO: flooding mpr ?
+  _update_flooding_mpr(neigh);
 
   list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
     if (listener->update) {
@@ -470,6 +563,69 @@ nhdp_domain_neighbor_changed(struct nhdp_neighbor *neigh) {
   }
 }
 
+/**
+ * Recalculate the neighbors whose incoming link metrics have been
+ * changed by nhdp_domain_set_incoming_metric(). The MPR sets and
+ * the domain listeners are only triggered for neighbors whose
+ * metric actually changed.
+ */
+void
+nhdp_domain_recalculate_metrics(void) {
+  struct nhdp_domain_listener *listener;
+  struct nhdp_domain *domain;
+  struct nhdp_neighbor *neigh, *n_it;
+  bool domain_changed[NHDP_MAXIMUM_DOMAINS];
+  struct list_entity changed;
+  bool neigh_changed;
+
+  memset(domain_changed, 0, sizeof(domain_changed));
+  list_init_head(&changed);
+
+  list_for_each_element_safe(&_dirty_neighbors, neigh, _dirty_node, n_it) {
+    list_remove(&neigh->_dirty_node);
+
+    neigh_changed = false;
+    list_for_each_element(&nhdp_domain_list, domain, _node) {
+      if (_recalculate_neighbor_metric(domain, neigh)) {
+        _recalculate_neighbor_2hops(domain, neigh);
+
+        domain_changed[domain->index] = true;
+        neigh_changed = true;
+      }
+    }
+
+    if (neigh_changed) {
+      list_add_tail(&changed, &neigh->_dirty_node);
+    }
+  }
+
+  /*
+   * update the MPR sets for each changed neighbor after all metrics
+   * are known, a neighbor that only changed in another domain is a
+   * cheap update without effect. Flooding MPRs only depend on
+   * outgoing metrics.
+   */
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    if (!domain_changed[domain->index] || domain->mpr->update_mpr == NULL) {
+      continue;
+    }
+
+    list_for_each_element(&changed, neigh, _dirty_node) {
+      domain->mpr->update_mpr(domain, neigh);
+    }
+  }
+
+  list_for_each_element_safe(&changed, neigh, _dirty_node, n_it) {
+    list_remove(&neigh->_dirty_node);
+
+    list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
+      if (listener->update) {
+        listener->update(neigh);
+      }
+    }
+  }
+}
+
 /**
  * Process an in MPR tlv for a NHDP link
  * @param domain NHDP domain
@@ -479,7 +635,7 @@ nhdp_domain_neighbor_changed(struct nhdp_neighbor *neigh) {
 void
 nhdp_domain_process_mpr_tlv(struct nhdp_domain *domain,
     struct nhdp_link *lnk, uint8_t tlvvalue) {
-  if (domain->ext == _flooding_ext) {
+  if (domain->ext == _flooding_ext && !_flooding_mpr->no_default_handling) {
     lnk->neigh->local_is_flooding_mpr =
         tlvvalue == RFC5444_MPR_FLOODING
         || tlvvalue == RFC5444_MPR_FLOOD_ROUTE;
@@ -509,6 +665,23 @@ nhdp_domain_process_willingness_tlv(struct nhdp_domain *domain,
   }
 }
 
+/**
+ * Store the willingness values of the last processed Willingness tlv
+ * in a NHDP neighbor
+ * @param domain pointer to NHDP domain
+ * @param neigh pointer to NHDP neighbor
+ */
+void
+nhdp_domain_store_willingness(struct nhdp_domain *domain,
+    struct nhdp_neighbor *neigh) {
+  nhdp_domain_get_neighbordata(domain, neigh)->willingness =
+      domain->mpr->_tmp_willingness;
+
+  if (domain->ext == _flooding_ext && !_flooding_mpr->no_default_handling) {
+    neigh->flooding_willingness = _flooding_mpr->_tmp_willingness;
+  }
+}
+
 /**
  * Calculates the tlvvalue of a Willingness tlv
  * @param domain domain of the Willingness tlv
@@ -566,6 +739,9 @@ nhdp_domain_get_mpr_tlvvalue(
  */
 void
 nhdp_domain_set_flooding_mpr(struct nhdp_domain_mpr *mpr, uint8_t ext) {
+  struct nhdp_neighbor *neigh;
+  struct nhdp_domain *domain;
+
   if (mpr == NULL) {
     _flooding_mpr = &_no_mprs;
     _flooding_ext = 0;
@@ -574,11 +750,26 @@ nhdp_domain_set_flooding_mpr(struct nhdp_domain_mpr *mpr, uint8_t ext) {
     _flooding_mpr = mpr;
     _flooding_ext = ext;
   }
+
+  /* reset flooding MPR settings of known neighbors */
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    neigh->flooding_willingness = _flooding_mpr->willingness;
+    neigh->local_is_flooding_mpr = _flooding_mpr->mprs_start;
+    neigh->neigh_is_flooding_mpr = _flooding_mpr->mpr_start;
+  }
+  _update_flooding_mpr(NULL);
+
+  /* the MPR TLVs of all domains might have changed */
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    oonf_class_event(&_domain_class, domain, OONF_OBJECT_CHANGED);
+  }
 }
 
 /**
  * Sets the incoming metric of a link. This is the only function external
  * code should use to commit the calculated metric values to the nhdp db.
+ * nhdp_domain_recalculate_metrics() must be called afterwards to
+ * update the neighbor metrics.
  * @param domain NHDP domain
  * @param lnk NHDP link
  * @param metric_in incoming metric value for NHDP link
@@ -586,18 +777,34 @@ nhdp_domain_set_flooding_mpr(struct nhdp_domain_mpr *mpr, uint8_t ext) {
 void
 nhdp_domain_set_incoming_metric(struct nhdp_domain *domain,
     struct nhdp_link *lnk, uint32_t metric_in) {
+  struct nhdp_domain_listener *listener;
   struct nhdp_link_domaindata *domaindata;
 
   domaindata = nhdp_domain_get_linkdata(domain, lnk);
+  if (domaindata->metric.in == metric_in) {
+    return;
+  }
   domaindata->metric.in = metric_in;
+
+  /* remember neighbor for nhdp_domain_recalculate_metrics() */
+  if (!list_is_node_added(&lnk->neigh->_dirty_node)) {
+    list_add_tail(&_dirty_neighbors, &lnk->neigh->_dirty_node);
+  }
+
+  list_for_each_element(&nhdp_domain_listener_list, listener, _node) {
+    if (listener->link_update) {
+      listener->link_update(lnk);
+    }
+  }
 }
 
 /**
  * Recalculate the 'best link/metric' values of a neighbor
  * @param domain NHDP domain
  * @param neigh NHDP neighbor
+ * @return true if the metric of the neighbor changed
  */
-static void
+static bool
 _recalculate_neighbor_metric(
     struct nhdp_domain *domain,
     struct nhdp_neighbor *neigh) {
@@ -639,6 +846,67 @@ _recalculate_neighbor_metric(
   if (memcmp(&oldmetric, &neighdata->metric, sizeof(oldmetric)) != 0) {
     /* mark metric as updated */
     domain->metric_changed = true;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Recalculate the best path costs of a global two-hop address
+ * through all links it is reachable through
+ * @param domain pointer to NHDP domain
+ * @param twohop global NHDP two-hop address
+ */
+static void
+_recalculate_2hop_metric(
+    struct nhdp_domain *domain, struct nhdp_2hop *twohop) {
+  struct nhdp_2hop_domaindata *data;
+  struct nhdp_neighbor_domaindata *neighdata;
+  struct nhdp_l2hop_domaindata *l2hopdata;
+  struct nhdp_l2hop *l2hop;
+
+  data = nhdp_domain_get_2hopdata(domain, twohop);
+
+  /* reset metric */
+  data->metric.in = RFC5444_METRIC_INFINITE_PATH;
+  data->metric.out = RFC5444_METRIC_INFINITE_PATH;
+  data->best_neigh = NULL;
+
+  /* get best path cost */
+  list_for_each_element(&twohop->_l2hops, l2hop, _2hop_node) {
+    neighdata = nhdp_domain_get_neighbordata(domain, l2hop->link->neigh);
+    l2hopdata = nhdp_domain_get_l2hopdata(domain, l2hop);
+
+    if (neighdata->metric.out < RFC5444_METRIC_INFINITE
+        && l2hopdata->metric.out < RFC5444_METRIC_INFINITE
+        && neighdata->metric.out + l2hopdata->metric.out < data->metric.out) {
+      data->metric.out = neighdata->metric.out + l2hopdata->metric.out;
+      data->best_neigh = l2hop->link->neigh;
+    }
+    if (neighdata->metric.in < RFC5444_METRIC_INFINITE
+        && l2hopdata->metric.in < RFC5444_METRIC_INFINITE
+        && neighdata->metric.in + l2hopdata->metric.in < data->metric.in) {
+      data->metric.in = neighdata->metric.in + l2hopdata->metric.in;
+    }
+  }
+}
+
+/**
+ * Recalculate the best path costs of all two-hop addresses
+ * reachable through a neighbor
+ * @param domain pointer to NHDP domain
+ * @param neigh NHDP neighbor
+ */
+static void
+_recalculate_neighbor_2hops(
+    struct nhdp_domain *domain, struct nhdp_neighbor *neigh) {
+  struct nhdp_link *lnk;
+  struct nhdp_l2hop *l2hop;
+
+  list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+    avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
+      _recalculate_2hop_metric(domain, l2hop->twohop);
+    }
   }
 }
 
@@ -671,10 +939,20 @@ nhdp_domain_add(uint8_t ext) {
   }
 
   domain->ext = ext;
-  domain->index = _domain_counter++;
+  domain->index = _domain_counter;
   domain->metric = &_no_metric;
   domain->mpr = &_no_mprs;
 
+  /* append the data of the new domain to the database objects */
+  if (_add_domain_data(domain)) {
+    OONF_WARN(LOG_NHDP, "Cannot add NHDP domain %u"
+        " while its database objects are in use,"
+        " a restart is necessary to add it", ext);
+    oonf_class_free(&_domain_class, domain);
+    return NULL;
+  }
+  _domain_counter++;
+
   /* initialize metric TLVs */
   for (i=0; i<4; i++) {
     domain->_metric_addrtlvs[i].type = RFC5444_ADDRTLV_LINK_METRIC;
@@ -829,9 +1107,32 @@ _apply_mpr(struct nhdp_domain *domain, const char *mpr_name) {
  */
 static void
 _remove_mpr(struct nhdp_domain *domain) {
+  struct nhdp_neighbor_domaindata *data;
+  struct nhdp_neighbor *neigh;
+
   strscpy(domain->mpr_name, CFG_DOMAIN_NO_MPR, sizeof(domain->mpr_name));
   domain->mpr->domain = NULL;
   domain->mpr = &_no_mprs;
+
+  /* everyone is MPR again */
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    data = nhdp_domain_get_neighbordata(domain, neigh);
+    data->willingness = _no_mprs.willingness;
+    data->local_is_mpr = _no_mprs.mprs_start;
+    data->neigh_is_mpr = _no_mprs.mpr_start;
+  }
+}
+
+/**
+ * Recalculate the flooding MPR set
+ * @param neigh neighbor that changed, NULL if the whole
+ *   neighborhood might have changed
+ */
+static void
+_update_flooding_mpr(struct nhdp_neighbor *neigh) {
+  if (_flooding_mpr->update_mpr != NULL) {
+    _flooding_mpr->update_mpr(nhdp_domain_get_by_ext(_flooding_ext), neigh);
+  }
 }
 
 /**
@@ -846,3 +1147,91 @@ _to_string(struct nhdp_metric_str *buf, uint32_t metric) {
 
   return buf->buf;
 }
+
+/**
+ * Append the data of a domain to the NHDP database objects and
+ * all registered per-domain class data
+ * @param domain NHDP domain
+ * @return 0 if successful, -1 if a class could not be extended
+ */
+static int
+_add_domain_data(struct nhdp_domain *domain) {
+  struct nhdp_domain_classdata *data, *registered;
+
+  if (_add_extension(&domain->_link_ext, NHDP_CLASS_LINK,
+      sizeof(struct nhdp_link_domaindata))) {
+    return -1;
+  }
+  if (_add_extension(&domain->_neigh_ext, NHDP_CLASS_NEIGHBOR,
+      sizeof(struct nhdp_neighbor_domaindata))) {
+    oonf_class_extension_remove(&domain->_link_ext);
+    return -1;
+  }
+  if (_add_extension(&domain->_l2hop_ext, NHDP_CLASS_LINK_2HOP,
+      sizeof(struct nhdp_l2hop_domaindata))) {
+    oonf_class_extension_remove(&domain->_neigh_ext);
+    oonf_class_extension_remove(&domain->_link_ext);
+    return -1;
+  }
+  if (_add_extension(&domain->_2hop_ext, NHDP_CLASS_2HOP,
+      sizeof(struct nhdp_2hop_domaindata))) {
+    oonf_class_extension_remove(&domain->_l2hop_ext);
+    oonf_class_extension_remove(&domain->_neigh_ext);
+    oonf_class_extension_remove(&domain->_link_ext);
+    return -1;
+  }
+
+  list_for_each_element(&_classdata_list, data, _node) {
+    if (_add_extension(&data->_ext[domain->index],
+        data->class_name, data->size)) {
+      /* only the class data before the failed one has been registered */
+      list_for_each_element(&_classdata_list, registered, _node) {
+        if (registered == data) {
+          break;
+        }
+        oonf_class_extension_remove(&registered->_ext[domain->index]);
+      }
+      oonf_class_extension_remove(&domain->_2hop_ext);
+      oonf_class_extension_remove(&domain->_l2hop_ext);
+      oonf_class_extension_remove(&domain->_neigh_ext);
+      oonf_class_extension_remove(&domain->_link_ext);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Remove the data of a domain from the NHDP database objects and
+ * all registered per-domain class data
+ * @param domain NHDP domain
+ */
+static void
+_remove_domain_data(struct nhdp_domain *domain) {
+  struct nhdp_domain_classdata *data;
+
+  list_for_each_element(&_classdata_list, data, _node) {
+    oonf_class_extension_remove(&data->_ext[domain->index]);
+  }
+  oonf_class_extension_remove(&domain->_2hop_ext);
+  oonf_class_extension_remove(&domain->_l2hop_ext);
+  oonf_class_extension_remove(&domain->_neigh_ext);
+  oonf_class_extension_remove(&domain->_link_ext);
+}
+
+/**
+ * Register a class extension for the data of one domain
+ * @param ext pointer to class extension
+ * @param class_name name of memory class
+ * @param size size of the domain data
+ * @return 0 if successful, -1 if the class could not be extended
+ */
+static int
+_add_extension(struct oonf_class_extension *ext,
+    const char *class_name, size_t size) {
+  ext->ext_name = "nhdp domain data";
+  ext->class_name = class_name;
+  ext->size = size;
+
+  return oonf_class_extension_add(ext);
+}
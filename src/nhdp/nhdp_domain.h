@@ -45,6 +45,7 @@
 #include "common/common_types.h"
 #include "common/list.h"
 #include "rfc5444/rfc5444_writer.h"
+#include "subsystems/oonf_class.h"
 #include "subsystems/oonf_rfc5444.h"
 
 #include "nhdp/nhdp_db.h"
@@ -92,8 +93,13 @@ struct nhdp_domain_mpr {
   /* name of handler */
   const char *name;
 
-  /* calculate MPR set */
-  void (*update_mpr)(void);
+  /*
+   * calculate MPR set, domain is NULL for a flooding MPR handler
+   * if no domain uses the flooding TLV extension. neigh is the
+   * neighbor whose links, two-hop addresses, metrics or willingness
+   * changed, NULL if the whole neighborhood might have changed.
+   */
+  void (*update_mpr)(struct nhdp_domain *, struct nhdp_neighbor *neigh);
 
   /* routing willingness */
   enum rfc5444_willingness_values willingness;
@@ -149,14 +155,42 @@ struct nhdp_domain {
   /* storage for the additional mpr tlv */
   struct rfc5444_writer_tlvtype _mpr_addrtlv;
 
+  /* domain data appended to the NHDP database objects */
+  struct oonf_class_extension _link_ext;
+  struct oonf_class_extension _neigh_ext;
+  struct oonf_class_extension _l2hop_ext;
+  struct oonf_class_extension _2hop_ext;
+
   /* list of nhdp domains */
   struct list_entity _node;
 };
 
+/*
+ * Per-domain data appended to the objects of a memory class.
+ * Each domain adds its own class extension, so objects only carry
+ * the data of the configured domains.
+ */
+struct nhdp_domain_classdata {
+  /* name of the memory class */
+  const char *class_name;
+
+  /* size of the data for one domain */
+  size_t size;
+
+  /* class extension of each domain */
+  struct oonf_class_extension _ext[NHDP_MAXIMUM_DOMAINS];
+
+  /* member of list of per-domain class data */
+  struct list_entity _node;
+};
+
 /* listener for NHDP domain updates */
 struct nhdp_domain_listener {
   void (*update)(struct nhdp_neighbor *);
 
+  /* called when the incoming metric of a link changed, might be NULL */
+  void (*link_update)(struct nhdp_link *);
+
   struct list_entity _node;
 };
 
@@ -180,6 +214,9 @@ EXPORT void nhdp_domain_mpr_remove(struct nhdp_domain_mpr *);
 EXPORT void nhdp_domain_listener_add(struct nhdp_domain_listener *);
 EXPORT void nhdp_domain_listener_remove(struct nhdp_domain_listener *);
 
+EXPORT int nhdp_domain_classdata_add(struct nhdp_domain_classdata *);
+EXPORT void nhdp_domain_classdata_remove(struct nhdp_domain_classdata *);
+
 EXPORT void nhdp_domain_set_flooding_mpr(
     struct nhdp_domain_mpr *, uint8_t ext);
 
@@ -188,6 +225,7 @@ EXPORT struct nhdp_domain *nhdp_domain_get_by_ext(uint8_t);
 EXPORT void nhdp_domain_init_link(struct nhdp_link *);
 EXPORT void nhdp_domain_init_l2hop(struct nhdp_l2hop *);
 EXPORT void nhdp_domain_init_neighbor(struct nhdp_neighbor *);
+EXPORT void nhdp_domain_recalculate_2hop(struct nhdp_2hop *);
 
 EXPORT void nhdp_domain_process_metric_linktlv(struct nhdp_domain *,
     struct nhdp_link *lnk, uint16_t tlvvalue);
@@ -196,11 +234,14 @@ EXPORT void nhdp_domain_process_metric_2hoptlv(struct nhdp_domain *d,
 
 EXPORT void nhdp_domain_neighborhood_changed(void);
 EXPORT void nhdp_domain_neighbor_changed(struct nhdp_neighbor *neigh);
+EXPORT void nhdp_domain_recalculate_metrics(void);
 
 EXPORT void nhdp_domain_process_mpr_tlv(struct nhdp_domain *,
     struct nhdp_link *lnk, uint8_t tlvvalue);
 EXPORT void nhdp_domain_process_willingness_tlv(
     struct nhdp_domain *, uint8_t tlvvalue);
+EXPORT void nhdp_domain_store_willingness(
+    struct nhdp_domain *, struct nhdp_neighbor *);
 EXPORT uint8_t nhdp_domain_get_willingness_tlvvalue(
     struct nhdp_domain *);
 EXPORT uint8_t nhdp_domain_get_mpr_tlvvalue(
@@ -216,7 +257,7 @@ EXPORT void nhdp_domain_set_incoming_metric(
  */
 static INLINE struct nhdp_link_domaindata *
 nhdp_domain_get_linkdata(struct nhdp_domain *domain, struct nhdp_link *lnk) {
-  return &lnk->_domaindata[domain->index];
+  return oonf_class_get_extension(&domain->_link_ext, lnk);
 }
 
 /**
@@ -227,7 +268,7 @@ nhdp_domain_get_linkdata(struct nhdp_domain *domain, struct nhdp_link *lnk) {
 static INLINE struct nhdp_neighbor_domaindata *
 nhdp_domain_get_neighbordata(
     struct nhdp_domain *domain, struct nhdp_neighbor *neigh) {
-  return &neigh->_domaindata[domain->index];
+  return oonf_class_get_extension(&domain->_neigh_ext, neigh);
 }
 
 /**
@@ -238,7 +279,30 @@ nhdp_domain_get_neighbordata(
 static INLINE struct nhdp_l2hop_domaindata *
 nhdp_domain_get_l2hopdata(
     struct nhdp_domain *domain, struct nhdp_l2hop *l2hop) {
-  return &l2hop->_domaindata[domain->index];
+  return oonf_class_get_extension(&domain->_l2hop_ext, l2hop);
+}
+
+/**
+ * @param domain NHDP domain
+ * @param twohop global NHDP two-hop address
+ * @return domain data of specified two-hop address
+ */
+static INLINE struct nhdp_2hop_domaindata *
+nhdp_domain_get_2hopdata(
+    struct nhdp_domain *domain, struct nhdp_2hop *twohop) {
+  return oonf_class_get_extension(&domain->_2hop_ext, twohop);
+}
+
+/**
+ * @param data per-domain class data
+ * @param domain NHDP domain
+ * @param ptr pointer to object of the class
+ * @return data of the domain appended to the object
+ */
+static INLINE void *
+nhdp_domain_get_classdata(struct nhdp_domain_classdata *data,
+    struct nhdp_domain *domain, void *ptr) {
+  return oonf_class_get_extension(&data->_ext[domain->index], ptr);
 }
 
 #endif /* NHDP_DOMAIN_H_ */
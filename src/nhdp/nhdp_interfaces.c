@@ -51,6 +51,7 @@
 #include "rfc5444/rfc5444_writer.h"
 #include "core/oonf_cfg.h"
 #include "core/oonf_logging.h"
+#include "core/os_core.h"
 #include "subsystems/oonf_class.h"
 #include "subsystems/oonf_interface.h"
 #include "subsystems/oonf_timer.h"
@@ -66,6 +67,9 @@ static void _cb_remove_addr(void *ptr);
 
 static int avl_comp_ifaddr(const void *k1, const void *k2);
 
+static bool _is_stable(struct nhdp_interface *);
+static void _send_hello(struct nhdp_interface *);
+static void _set_hello_timer(struct nhdp_interface *, uint64_t interval);
 static void _cb_generate_hello(void *ptr);
 static void _cb_interface_event(struct oonf_rfc5444_interface_listener *, bool);
 
@@ -81,7 +85,6 @@ static struct oonf_class _interface_info = {
 
 static struct oonf_timer_info _interface_hello_timer = {
   .name = "NHDP hello timer",
-  .periodic = true,
   .callback = _cb_generate_hello,
 };
 
@@ -98,6 +101,9 @@ static struct oonf_timer_info _removed_address_hold_timer = {
 /* other global variables */
 static struct oonf_rfc5444_protocol *_protocol;
 
+/* nhdp interface of the last received packet */
+static struct nhdp_interface *_input_interface = NULL;
+
 /**
  * Initialize NHDP interface subsystem
  */
@@ -279,6 +285,10 @@ nhdp_interface_remove(struct nhdp_interface *interf) {
   }
 
   oonf_interface_remove_listener(&interf->core_if_listener);
+  if (_input_interface == interf) {
+    _input_interface = NULL;
+  }
+
   oonf_rfc5444_remove_interface(interf->rfc5444_if.interface, &interf->rfc5444_if);
   avl_remove(&nhdp_interface_tree, &interf->_node);
   oonf_class_free(&_interface_info, interf);
@@ -293,8 +303,15 @@ nhdp_interface_apply_settings(struct nhdp_interface *interf) {
   /* parse ip address list again and apply ACL */
   _cb_interface_event(&interf->rfc5444_if, false);
 
-  /* reset hello generation frequency */
-  oonf_timer_set(&interf->_hello_timer, interf->refresh_interval);
+  /* a maximum below the normal interval disables the adaptive interval */
+  if (interf->refresh_max_interval < interf->refresh_interval) {
+    interf->refresh_max_interval = interf->refresh_interval;
+  }
+
+  /* restart adaptive hello interval */
+  interf->hello_interval = interf->refresh_interval;
+  interf->_hello_triggered = false;
+  _set_hello_timer(interf, interf->hello_interval);
 
   /* just copy hold time for now */
   interf->l_hold_time = interf->h_hold_time;
@@ -302,6 +319,162 @@ nhdp_interface_apply_settings(struct nhdp_interface *interf) {
   interf->i_hold_time = interf->n_hold_time;
 }
 
+/**
+ * Send the next HELLO of an interface right now if it would be due
+ * within a time window anyway. This allows the HELLO to share an
+ * RFC5444 packet with other messages generated at the same time.
+ * @param interf pointer to nhdp interface
+ * @param window maximum time the HELLO is sent early
+ * @return true if a HELLO was sent
+ */
+bool
+nhdp_interface_send_hello_early(
+    struct nhdp_interface *interf, uint64_t window) {
+  if (!oonf_timer_is_active(&interf->_hello_timer)
+      || oonf_timer_get_due(&interf->_hello_timer) > window) {
+    return false;
+  }
+
+  _send_hello(interf);
+  interf->hellos_aggregated++;
+  return true;
+}
+
+/**
+ * Count a locally generated message sent to a multicast target
+ * of an interface.
+ * @param interf pointer to nhdp interface
+ * @param target rfc5444 target of the message
+ */
+void
+nhdp_interface_count_message(
+    struct nhdp_interface *interf, struct oonf_rfc5444_target *target) {
+  if (target == target->interface->multicast4) {
+    interf->_message_pending[0] = true;
+  }
+  else if (target == target->interface->multicast6) {
+    interf->_message_pending[1] = true;
+  }
+  else {
+    /* only count messages to multicast targets */
+    return;
+  }
+  interf->messages_sent++;
+}
+
+/**
+ * Count a RFC5444 packet sent to a multicast target of an interface.
+ * Only packets containing messages counted by
+ * nhdp_interface_count_message() are counted, so both counters
+ * are based on the same set of messages.
+ * @param interf pointer to nhdp interface
+ * @param target rfc5444 target of the packet
+ */
+void
+nhdp_interface_count_packet(
+    struct nhdp_interface *interf, struct oonf_rfc5444_target *target) {
+  int idx;
+
+  if (target == target->interface->multicast4) {
+    idx = 0;
+  }
+  else if (target == target->interface->multicast6) {
+    idx = 1;
+  }
+  else {
+    return;
+  }
+
+  if (interf->_message_pending[idx]) {
+    interf->_message_pending[idx] = false;
+    interf->packets_sent++;
+  }
+}
+
+/**
+ * Reset the hello interval of an interface to its minimum because
+ * one of its links changed. A pending hello is pulled forward to
+ * the minimum interval, but no hello is sent immediately.
+ * @param interf pointer to nhdp interface
+ */
+void
+nhdp_interface_trigger_hello(struct nhdp_interface *interf) {
+  interf->_hello_triggered = true;
+
+  if (oonf_timer_is_active(&interf->_hello_timer)
+      && oonf_timer_get_due(&interf->_hello_timer) > interf->refresh_interval) {
+    _set_hello_timer(interf, interf->refresh_interval);
+  }
+}
+
+/**
+ * @param interf pointer to nhdp interface
+ * @return validity of the hellos of an interface, scaled with
+ *   the current hello interval
+ */
+uint64_t
+nhdp_interface_get_hello_validity(struct nhdp_interface *interf) {
+  if (interf->refresh_interval == 0) {
+    /* not configured yet */
+    return interf->h_hold_time;
+  }
+  return interf->h_hold_time
+      * interf->hello_interval / interf->refresh_interval;
+}
+
+/**
+ * Get the nhdp interface of the packet currently being received.
+ * The result of the name based lookup is remembered until a packet
+ * from a different interface arrives.
+ * @return nhdp interface of incoming packet, NULL if not available
+ */
+struct nhdp_interface *
+nhdp_interface_get_input(void) {
+  if (_protocol->input_interface == NULL) {
+    return NULL;
+  }
+
+  if (_input_interface == NULL
+      || _input_interface->rfc5444_if.interface != _protocol->input_interface) {
+    _input_interface = nhdp_interface_get(_protocol->input_interface->name);
+  }
+  return _input_interface;
+}
+
+/**
+ * Get the link address of the source of the packet currently being
+ * received. The interface keeps a small cache of link addresses
+ * indexed by the last byte of the address.
+ * @param interf nhdp interface of incoming packet
+ * @return link address of incoming packet, NULL if not a known link
+ */
+struct nhdp_laddr *
+nhdp_interface_get_input_laddr(struct nhdp_interface *interf) {
+  const struct netaddr *src;
+  struct nhdp_laddr *laddr;
+  const uint8_t *bin;
+  int idx;
+
+  src = _protocol->input_address;
+  if (src == NULL) {
+    return NULL;
+  }
+
+  bin = netaddr_get_binptr(src);
+  idx = bin[netaddr_get_binlength(src) - 1] % NHDP_INTERFACE_LADDR_CACHE;
+
+  laddr = interf->_laddr_cache[idx];
+  if (laddr != NULL && netaddr_cmp(&laddr->link_addr, src) == 0) {
+    return laddr;
+  }
+
+  laddr = nhdp_interface_get_link_addr(interf, src);
+  if (laddr != NULL) {
+    interf->_laddr_cache[idx] = laddr;
+  }
+  return laddr;
+}
+
 /**
  * Add a nhdp interface address to an interface
  * @param interf pointer to nhdp interface
@@ -345,7 +518,13 @@ _addr_add(struct nhdp_interface *interf, struct netaddr *addr) {
   else {
     oonf_timer_stop(&if_addr->_vtime);
     if_addr->_to_be_removed = false;
-    if_addr->removed = false;
+
+    if (if_addr->removed) {
+      if_addr->removed = false;
+
+      /* trigger event */
+      oonf_class_event(&_addr_info, if_addr, OONF_OBJECT_CHANGED);
+    }
   }
   return;
 }
@@ -366,6 +545,9 @@ _addr_remove(struct nhdp_interface_addr *addr, uint64_t vtime) {
 
   addr->removed = true;
   oonf_timer_set(&addr->_vtime, vtime);
+
+  /* trigger event */
+  oonf_class_event(&_addr_info, addr, OONF_OBJECT_CHANGED);
 }
 
 /**
@@ -416,7 +598,69 @@ avl_comp_ifaddr(const void *k1, const void *k2) {
  */
 static void
 _cb_generate_hello(void *ptr) {
-  nhdp_writer_send_hello(ptr);
+  _send_hello(ptr);
+}
+
+/**
+ * @param interf pointer to nhdp interface
+ * @return true if all links of the interface are symmetric
+ */
+static bool
+_is_stable(struct nhdp_interface *interf) {
+  struct nhdp_link *lnk;
+
+  list_for_each_element(&interf->_links, lnk, _if_node) {
+    if (lnk->status != NHDP_LINK_SYMMETRIC) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Adapt the hello interval of an interface, send a hello and
+ * restart the hello timer.
+ * @param interf pointer to nhdp interface
+ */
+static void
+_send_hello(struct nhdp_interface *interf) {
+  if (interf->_hello_triggered || !_is_stable(interf)) {
+    /* links are changing, go back to the fast hello interval */
+    interf->hello_interval = interf->refresh_interval;
+    interf->_hello_triggered = false;
+  }
+  else if (interf->hello_interval < interf->refresh_max_interval) {
+    /*
+     * all links are stable, slowly increase the hello interval.
+     * Grow by a quarter only, neighbors consider a hello lost if it
+     * is not received within 1.5 times of the last interval.
+     */
+    interf->hello_interval += interf->hello_interval / 4;
+    if (interf->hello_interval > interf->refresh_max_interval) {
+      interf->hello_interval = interf->refresh_max_interval;
+    }
+  }
+
+  nhdp_writer_send_hello(interf);
+  _set_hello_timer(interf, interf->hello_interval);
+}
+
+/**
+ * Start the hello timer of an interface. The interval is reduced
+ * by a random jitter of up to 25% (see RFC 5148, 5.4) to prevent
+ * neighbors from synchronizing their hellos.
+ * @param interf pointer to nhdp interface
+ * @param interval hello interval
+ */
+static void
+_set_hello_timer(struct nhdp_interface *interf, uint64_t interval) {
+  uint64_t jitter;
+
+  jitter = interval / 4;
+  if (jitter > 0) {
+    interval -= (uint64_t)os_core_random() % jitter;
+  }
+  oonf_timer_set(&interf->_hello_timer, interval);
 }
 
 /**
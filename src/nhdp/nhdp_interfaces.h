@@ -60,6 +60,9 @@ struct nhdp_interface_addr;
 #define NHDP_CLASS_INTERFACE         "nhdp_interf"
 #define NHDP_CLASS_INTERFACE_ADDRESS "nhdp_iaddr"
 
+/* number of cached link addresses for the receive path of an interface */
+#define NHDP_INTERFACE_LADDR_CACHE 8
+
 /**
  * nhdp_interface represents a local interface participating in the mesh network
  */
@@ -73,6 +76,9 @@ struct nhdp_interface {
   /* interval between two hellos sent through this interface */
   uint64_t refresh_interval;
 
+  /* maximum hello interval if all links of this interface are stable */
+  uint64_t refresh_max_interval;
+
   /* See RFC 6130, 5.3.2 and 5.4.1 */
   uint64_t h_hold_time;
   uint64_t l_hold_time;
@@ -92,6 +98,22 @@ struct nhdp_interface {
   /* address family used for dualstack purpose */
   int dualstack_af_type;
 
+  /*
+   * number of locally generated NHDP/OLSRv2 messages sent and
+   * number of RFC5444 packets they were sent in
+   */
+  uint32_t packets_sent;
+  uint32_t messages_sent;
+
+  /* number of HELLOs sent early to share a packet with a TC */
+  uint32_t hellos_aggregated;
+
+  /* current adaptive hello interval */
+  uint64_t hello_interval;
+
+  /* true if a link of this interface changed since the last hello */
+  bool _hello_triggered;
+
   /* timer for hello generation */
   struct oonf_timer_entry _hello_timer;
 
@@ -109,6 +131,12 @@ struct nhdp_interface {
 
   /* tree of originator addresses of links (nhdp_link objects */
   struct avl_tree _link_originators;
+
+  /* link addresses of recently received packets */
+  struct nhdp_laddr *_laddr_cache[NHDP_INTERFACE_LADDR_CACHE];
+
+  /* true if a counted message waits for the next IPv4/IPv6 packet */
+  bool _message_pending[2];
 };
 
 /**
@@ -147,6 +175,17 @@ EXPORT struct nhdp_interface *nhdp_interface_add(const char *name);
 EXPORT void nhdp_interface_remove(struct nhdp_interface *interf);
 EXPORT void nhdp_interface_apply_settings(struct nhdp_interface *interf);
 EXPORT void nhdp_interface_update_status(struct nhdp_interface *);
+EXPORT void nhdp_interface_trigger_hello(struct nhdp_interface *);
+EXPORT uint64_t nhdp_interface_get_hello_validity(struct nhdp_interface *);
+EXPORT bool nhdp_interface_send_hello_early(
+    struct nhdp_interface *interf, uint64_t window);
+EXPORT void nhdp_interface_count_message(
+    struct nhdp_interface *interf, struct oonf_rfc5444_target *target);
+EXPORT void nhdp_interface_count_packet(
+    struct nhdp_interface *interf, struct oonf_rfc5444_target *target);
+EXPORT struct nhdp_interface *nhdp_interface_get_input(void);
+EXPORT struct nhdp_laddr *nhdp_interface_get_input_laddr(
+    struct nhdp_interface *interf);
 
 /**
  * @param interface name
@@ -229,7 +268,16 @@ nhdp_interface_add_laddr(struct nhdp_laddr *laddr) {
  */
 static INLINE void
 nhdp_interface_remove_laddr(struct nhdp_laddr *laddr) {
-  avl_remove(&laddr->link->local_if->_link_addresses, &laddr->_if_node);
+  struct nhdp_interface *interf;
+  int i;
+
+  interf = laddr->link->local_if;
+  for (i = 0; i < NHDP_INTERFACE_LADDR_CACHE; i++) {
+    if (interf->_laddr_cache[i] == laddr) {
+      interf->_laddr_cache[i] = NULL;
+    }
+  }
+  avl_remove(&interf->_link_addresses, &laddr->_if_node);
 }
 
 /**
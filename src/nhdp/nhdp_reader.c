@@ -376,7 +376,7 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
   memset(&_current, 0, sizeof(_current));
 
   /* remember local NHDP interface */
-  _current.localif = nhdp_interface_get(_protocol->input_interface->name);
+  _current.localif = nhdp_interface_get_input();
 
   /* extract originator address */
   if (context->has_origaddr) {
@@ -393,7 +393,13 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
         _nhdp_message_tlvs[IDX_TLV_ITIME].tlv->single_value[0]);
   }
 
-  /* extract willingness */
+  /* extract willingness, a missing TLV means 'never' */
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    if (!domain->mpr->no_default_handling) {
+      nhdp_domain_process_willingness_tlv(domain, RFC5444_WILLINGNESS_NEVER);
+    }
+  }
+
   tlv = _nhdp_message_tlvs[IDX_TLV_WILLINGNESS].tlv;
   while (tlv) {
     domain = nhdp_domain_get_by_ext(tlv->type_ext);
@@ -668,7 +674,7 @@ _process_domainspecific_linkdata(struct netaddr *addr __attribute__((unused))) {
     neighdata = nhdp_domain_get_neighbordata(domain, _current.neighbor);
 
     if (!domain->mpr->no_default_handling) {
-      neighdata->local_is_mpr = false;
+      nhdp_domain_process_mpr_tlv(domain, _current.link, RFC5444_MPR_NOMPR);
       neighdata->willingness = 0;
     }
 
@@ -712,10 +718,10 @@ _process_domainspecific_linkdata(struct netaddr *addr __attribute__((unused))) {
     tlv = tlv->next_entry;
   }
 
-  /* process willingness TLVs stored from message TLV processing */
+  /* store willingness TLVs from message TLV processing */
   list_for_each_element(&nhdp_domain_list, domain, _node) {
     if (!domain->mpr->no_default_handling) {
-      nhdp_domain_process_willingness_tlv(domain, domain->mpr->_tmp_willingness);
+      nhdp_domain_store_willingness(domain, _current.neighbor);
     }
   }
 }
@@ -39,6 +39,9 @@
  *
  */
 
+#include <stddef.h>
+#include <stdlib.h>
+
 #include "common/common_types.h"
 #include "common/avl.h"
 #include "common/avl_comp.h"
@@ -46,9 +49,12 @@
 #include "rfc5444/rfc5444.h"
 #include "rfc5444/rfc5444_writer.h"
 #include "core/oonf_logging.h"
+#include "subsystems/oonf_class.h"
 #include "subsystems/oonf_rfc5444.h"
 
 #include "nhdp/nhdp.h"
+#include "nhdp/nhdp_address_group.h"
+#include "nhdp/nhdp_db.h"
 #include "nhdp/nhdp_interfaces.h"
 #include "nhdp/nhdp_domain.h"
 #include "nhdp/nhdp_writer.h"
@@ -60,23 +66,104 @@ enum {
   IDX_ADDRTLV_OTHER_NEIGHB,
 };
 
+/* address of a HELLO together with the values of all its address TLVs */
+struct _hello_address {
+  struct netaddr addr;
+
+  /* value of LOCAL_IF tlv, 255 if not present */
+  uint8_t localif;
+
+  /* value of LINK_STATUS tlv, 255 if not present */
+  uint8_t linkstatus;
+
+  /* value of OTHER_NEIGHB tlv, 255 if not present */
+  uint8_t otherneigh;
+
+  /* value of MPR tlv per domain, RFC5444_MPR_NOMPR if not present */
+  uint8_t mpr[NHDP_MAXIMUM_DOMAINS];
+
+  /* bitmask of used linkmetric slots per domain */
+  uint8_t metric_slots[NHDP_MAXIMUM_DOMAINS];
+
+  /*
+   * linkmetric tlv values (network byte order) per domain, the slot is
+   * the index of the first metric (link in/out, neighbor in/out) the
+   * value contains
+   */
+  uint16_t metric[NHDP_MAXIMUM_DOMAINS][4];
+};
+
+/* ordered addresses of a HELLO of one address family */
+struct _hello_cache {
+  struct _hello_address *addr;
+  size_t count, size;
+
+  /* true if the addresses are still up to date */
+  bool valid;
+};
+
+/* HELLO data of a NHDP interface */
+struct _hello_interface {
+  /* cached addresses of IPv4 and IPv6 HELLOs */
+  struct _hello_cache cache[2];
+};
+
+/* HELLO relevant state of a NHDP link when the cache was checked */
+struct _hello_link {
+  enum nhdp_link_status status;
+  struct nhdp_metric metric[NHDP_MAXIMUM_DOMAINS];
+};
+
+/* HELLO relevant state of a NHDP neighbor when the cache was checked */
+struct _hello_neighbor {
+  bool symmetric;
+  bool flooding_mpr;
+  bool mpr[NHDP_MAXIMUM_DOMAINS];
+  struct nhdp_metric metric[NHDP_MAXIMUM_DOMAINS];
+};
+
 /* prototypes */
 static void _cb_addMessageHeader(
     struct rfc5444_writer *, struct rfc5444_writer_message *);
 static void _cb_addMessageTLVs(struct rfc5444_writer *);
 static void _cb_addAddresses(struct rfc5444_writer *);
-
-static void _add_link_address(struct rfc5444_writer *writer,
-    struct rfc5444_writer_content_provider *prv,
+static void _cb_finishMessageTLVs(struct rfc5444_writer *,
+  struct rfc5444_writer_address *start,
+  struct rfc5444_writer_address *end, bool complete);
+static void _cb_addPacketTLVs(
+    struct rfc5444_writer *, struct rfc5444_writer_target *);
+
+static void _plan_hello(struct _hello_cache *cache,
+    struct nhdp_interface *interf, int af_type);
+static bool _hello_order_useful(void);
+static struct _hello_address *_get_hello_address(struct _hello_cache *cache);
+static void _init_hello_address(struct _hello_address *entry);
+static void _plan_link_address(struct _hello_address *entry,
     struct nhdp_interface *interf, struct nhdp_naddr *naddr);
-static void _add_localif_address(struct rfc5444_writer *writer,
-    struct rfc5444_writer_content_provider *prv,
+static void _plan_localif_address(struct _hello_address *entry,
     struct nhdp_interface *interf, struct nhdp_interface_addr *addr);
-
-static void _write_metric_tlv(struct rfc5444_writer *writer,
-    struct rfc5444_writer_address *addr,
+static void _plan_metric_tlv(struct _hello_address *entry,
     struct nhdp_neighbor *neigh, struct nhdp_link *lnk,
     struct nhdp_domain *domain);
+static void _write_hello_address(struct rfc5444_writer *writer,
+    struct rfc5444_writer_content_provider *prv,
+    struct _hello_address *entry);
+static int _cb_compare_hello_address(const void *, const void *);
+static void _write_unordered_hello(struct rfc5444_writer *writer,
+    struct nhdp_interface *interf, int af_type);
+
+static void _invalidate_interface(struct nhdp_interface *interf);
+static void _invalidate_all(void);
+static void _check_neighbor(struct nhdp_neighbor *neigh);
+static bool _link_state_changed(struct nhdp_link *lnk);
+static bool _neighbor_state_changed(struct nhdp_neighbor *neigh);
+static bool _mpr_state_changed(struct nhdp_neighbor *neigh);
+static void _cb_interface_removed(void *);
+static void _cb_link_changed(void *);
+static void _cb_laddr_changed(void *);
+static void _cb_neighborhood_changed(void *);
+static void _cb_nhdp_update(struct nhdp_neighbor *);
+static void _cb_nhdp_link_update(struct nhdp_link *);
 
 /* definition of NHDP writer */
 static struct rfc5444_writer_message *_nhdp_message = NULL;
@@ -85,6 +172,7 @@ static struct rfc5444_writer_content_provider _nhdp_msgcontent_provider = {
   .msg_type = RFC5444_MSGTYPE_HELLO,
   .addMessageTLVs = _cb_addMessageTLVs,
   .addAddresses = _cb_addAddresses,
+  .finishMessageTLVs = _cb_finishMessageTLVs,
 };
 
 static struct rfc5444_writer_tlvtype _nhdp_addrtlvs[] = {
@@ -93,8 +181,81 @@ static struct rfc5444_writer_tlvtype _nhdp_addrtlvs[] = {
   [IDX_ADDRTLV_OTHER_NEIGHB] = { .type = RFC5444_ADDRTLV_OTHER_NEIGHB },
 };
 
+/* packet handler to count the packets sent per interface */
+static struct rfc5444_writer_pkthandler _nhdp_pkthandler = {
+  .addPacketTLVs = _cb_addPacketTLVs,
+};
+
+/* cached HELLO addresses and the state they depend on */
+static struct oonf_class_extension _interface_extension = {
+  .ext_name = "nhdp writer",
+  .class_name = NHDP_CLASS_INTERFACE,
+  .size = sizeof(struct _hello_interface),
+
+  .cb_remove = _cb_interface_removed,
+};
+
+static struct oonf_class_extension _link_extension = {
+  .ext_name = "nhdp writer",
+  .class_name = NHDP_CLASS_LINK,
+  .size = sizeof(struct _hello_link),
+
+  .cb_add = _cb_neighborhood_changed,
+  .cb_change = _cb_link_changed,
+  .cb_remove = _cb_neighborhood_changed,
+};
+
+static struct oonf_class_extension _neighbor_extension = {
+  .ext_name = "nhdp writer",
+  .class_name = NHDP_CLASS_NEIGHBOR,
+  .size = sizeof(struct _hello_neighbor),
+};
+
+static struct oonf_class_extension _laddr_listener = {
+  .ext_name = "nhdp writer",
+  .class_name = NHDP_CLASS_LINK_ADDRESS,
+
+  .cb_add = _cb_laddr_changed,
+  .cb_change = _cb_laddr_changed,
+  .cb_remove = _cb_laddr_changed,
+};
+
+static struct oonf_class_extension _naddr_listener = {
+  .ext_name = "nhdp writer",
+  .class_name = NHDP_CLASS_NEIGHBOR_ADDRESS,
+
+  .cb_add = _cb_neighborhood_changed,
+  .cb_change = _cb_neighborhood_changed,
+  .cb_remove = _cb_neighborhood_changed,
+};
+
+static struct oonf_class_extension _ifaddr_listener = {
+  .ext_name = "nhdp writer",
+  .class_name = NHDP_CLASS_INTERFACE_ADDRESS,
+
+  .cb_add = _cb_neighborhood_changed,
+  .cb_change = _cb_neighborhood_changed,
+  .cb_remove = _cb_neighborhood_changed,
+};
+
+static struct oonf_class_extension _domain_listener = {
+  .ext_name = "nhdp writer",
+  .class_name = NHDP_CLASS_DOMAIN,
+
+  .cb_add = _cb_neighborhood_changed,
+  .cb_change = _cb_neighborhood_changed,
+};
+
+static struct nhdp_domain_listener _nhdp_listener = {
+  .update = _cb_nhdp_update,
+  .link_update = _cb_nhdp_link_update,
+};
+
 static struct oonf_rfc5444_protocol *_protocol;
 
+/* interface the HELLOs are currently generated for */
+static struct nhdp_interface *_hello_interface = NULL;
+
 static bool _cleanedup = false;
 
 /**
@@ -121,6 +282,26 @@ nhdp_writer_init(struct oonf_rfc5444_protocol *p) {
     rfc5444_writer_unregister_message(&_protocol->writer, _nhdp_message);
     return -1;
   }
+
+  if (oonf_class_extension_add(&_interface_extension)
+      || oonf_class_extension_add(&_link_extension)
+      || oonf_class_extension_add(&_neighbor_extension)) {
+    OONF_WARN(LOG_NHDP_W, "Could not register NHDP hello cache");
+    oonf_class_extension_remove(&_link_extension);
+    oonf_class_extension_remove(&_interface_extension);
+    rfc5444_writer_unregister_content_provider(
+        &_protocol->writer, &_nhdp_msgcontent_provider,
+        _nhdp_addrtlvs, ARRAYSIZE(_nhdp_addrtlvs));
+    rfc5444_writer_unregister_message(&_protocol->writer, _nhdp_message);
+    return -1;
+  }
+  oonf_class_extension_add(&_laddr_listener);
+  oonf_class_extension_add(&_naddr_listener);
+  oonf_class_extension_add(&_ifaddr_listener);
+  oonf_class_extension_add(&_domain_listener);
+  nhdp_domain_listener_add(&_nhdp_listener);
+
+  rfc5444_writer_register_pkthandler(&_protocol->writer, &_nhdp_pkthandler);
   return 0;
 }
 
@@ -129,16 +310,52 @@ nhdp_writer_init(struct oonf_rfc5444_protocol *p) {
  */
 void
 nhdp_writer_cleanup(void) {
+  struct nhdp_interface *interf;
+
   /* remember we already did shut down the writer */
   _cleanedup = true;
 
+  /* free cached HELLO addresses */
+  avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+    _cb_interface_removed(interf);
+  }
+
+  nhdp_domain_listener_remove(&_nhdp_listener);
+  oonf_class_extension_remove(&_domain_listener);
+  oonf_class_extension_remove(&_ifaddr_listener);
+  oonf_class_extension_remove(&_naddr_listener);
+  oonf_class_extension_remove(&_laddr_listener);
+  oonf_class_extension_remove(&_neighbor_extension);
+  oonf_class_extension_remove(&_link_extension);
+  oonf_class_extension_remove(&_interface_extension);
+
   /* remove pbb writer */
+  rfc5444_writer_unregister_pkthandler(&_protocol->writer, &_nhdp_pkthandler);
   rfc5444_writer_unregister_content_provider(
       &_protocol->writer, &_nhdp_msgcontent_provider,
       _nhdp_addrtlvs, ARRAYSIZE(_nhdp_addrtlvs));
   rfc5444_writer_unregister_message(&_protocol->writer, _nhdp_message);
 }
 
+/**
+ * Compare the address family, the prefix length and the network part
+ * (/16 for IPv4, /48 for IPv6) of two addresses. RFC5444 writers use
+ * this as the primary sort key for their addresses, so addresses with a
+ * common head end up next to each other and can share an address block.
+ * @param a1 first address
+ * @param a2 second address
+ * @return <0, 0 or >0 like memcmp()
+ */
+int
+nhdp_writer_compare_address_group(
+    const struct netaddr *a1, const struct netaddr *a2) {
+  return nhdp_address_group_compare(
+      netaddr_get_address_family(a1), netaddr_get_prefix_length(a1),
+      netaddr_get_binptr(a1),
+      netaddr_get_address_family(a2), netaddr_get_prefix_length(a2),
+      netaddr_get_binptr(a2), netaddr_get_binlength(a1));
+}
+
 /**
  * Send a NHDP Hello through the specified interface. This might result
  * in both an IPv4 and IPv6 message
@@ -164,6 +381,8 @@ nhdp_writer_send_hello(struct nhdp_interface *ninterf) {
   OONF_DEBUG(LOG_NHDP_W, "Sending Hello to interface %s",
       nhdp_interface_get_name(ninterf));
 
+  _hello_interface = ninterf;
+
   /* send IPv4 (if socket is active) */
   result = oonf_rfc5444_send_if(ninterf->rfc5444_if.interface->multicast4, RFC5444_MSGTYPE_HELLO);
   if (result < 0) {
@@ -177,6 +396,8 @@ nhdp_writer_send_hello(struct nhdp_interface *ninterf) {
     OONF_WARN(LOG_NHDP_W, "Could not send NHDP message to %s: %s (%d)",
         netaddr_to_string(&buf, &ninterf->rfc5444_if.interface->multicast6->dst), rfc5444_strerror(result), result);
   }
+
+  _hello_interface = NULL;
 }
 
 /**
@@ -228,6 +449,50 @@ _cb_addMessageHeader(struct rfc5444_writer *writer,
   }
 }
 
+/**
+ * Callback for each RFC5444 packet generated by the protocol,
+ * used to count the packets sent through each NHDP interface
+ * @param writer rfc5444 writer
+ * @param rfc5444_target rfc5444 target of the packet
+ */
+static void
+_cb_addPacketTLVs(struct rfc5444_writer *writer __attribute__((unused)),
+    struct rfc5444_writer_target *rfc5444_target) {
+  struct oonf_rfc5444_target *target;
+  struct nhdp_interface *interf;
+
+  target = container_of(rfc5444_target, struct oonf_rfc5444_target, rfc5444_target);
+  if (target != target->interface->multicast4
+      && target != target->interface->multicast6) {
+    /* only count packets to multicast targets */
+    return;
+  }
+
+  interf = nhdp_interface_get(target->interface->name);
+  if (interf != NULL) {
+    nhdp_interface_count_packet(interf, target);
+  }
+}
+
+/**
+ * Callback triggered when a HELLO (or a fragment of it) is finished,
+ * used to count the messages sent through each NHDP interface
+ * @param writer rfc5444 writer
+ * @param start
+ * @param end
+ * @param complete
+ */
+static void
+_cb_finishMessageTLVs(struct rfc5444_writer *writer,
+    struct rfc5444_writer_address *start __attribute__((unused)),
+    struct rfc5444_writer_address *end __attribute__((unused)),
+    bool complete __attribute__((unused))) {
+  if (_hello_interface != NULL) {
+    nhdp_interface_count_message(_hello_interface,
+        oonf_rfc5444_get_target_from_writer(writer));
+  }
+}
+
 /**
  * Callback to add the message TLVs to a HELLO message
  * @param writer
@@ -257,8 +522,9 @@ _cb_addMessageTLVs(struct rfc5444_writer *writer) {
     OONF_WARN(LOG_NHDP_W, "Unknown interface for nhdp message: %s", target->interface->name);
     assert(0);
   }
-  itime_encoded = rfc5444_timetlv_encode(interf->refresh_interval);
-  vtime_encoded = rfc5444_timetlv_encode(interf->h_hold_time);
+  itime_encoded = rfc5444_timetlv_encode(interf->hello_interval);
+  vtime_encoded = rfc5444_timetlv_encode(
+      nhdp_interface_get_hello_validity(interf));
 
   rfc5444_writer_add_messagetlv(writer, RFC5444_MSGTLV_INTERVAL_TIME, 0,
       &itime_encoded, sizeof(itime_encoded));
@@ -297,18 +563,104 @@ _cb_addMessageTLVs(struct rfc5444_writer *writer) {
 }
 
 /**
- * Add a rfc5444 address with localif TLV to the stream
- * @param writer
- * @param prv
+ * Collect and order all addresses of a HELLO
+ * @param cache HELLO address cache to fill
+ * @param interf NHDP interface the HELLO is generated for
+ * @param af_type address family of the HELLO
+ */
+static void
+_plan_hello(struct _hello_cache *cache,
+    struct nhdp_interface *interf, int af_type) {
+  struct nhdp_interface_addr *addr;
+  struct nhdp_naddr *naddr;
+  struct _hello_address *entry;
+
+  cache->count = 0;
+  cache->valid = true;
+
+  /* collect interface addresses */
+  avl_for_each_element(&nhdp_ifaddr_tree, addr, _global_node) {
+    if (addr->removed
+        || netaddr_get_address_family(&addr->if_addr) != af_type) {
+      continue;
+    }
+    entry = _get_hello_address(cache);
+    if (entry == NULL) {
+      return;
+    }
+    _plan_localif_address(entry, interf, addr);
+  }
+
+  /* then collect neighbor addresses */
+  avl_for_each_element(&nhdp_naddr_tree, naddr, _global_node) {
+    if (netaddr_get_address_family(&naddr->neigh_addr) != af_type) {
+      continue;
+    }
+    entry = _get_hello_address(cache);
+    if (entry == NULL) {
+      return;
+    }
+    _plan_link_address(entry, interf, naddr);
+  }
+
+  /* order addresses for best compression */
+  qsort(cache->addr, cache->count,
+      sizeof(*cache->addr), _cb_compare_hello_address);
+}
+
+/**
+ * @param cache HELLO address cache
+ * @return pointer to a new zeroed entry of the HELLO address cache,
+ *   NULL if out of memory
+ */
+static struct _hello_address *
+_get_hello_address(struct _hello_cache *cache) {
+  struct _hello_address *array, *entry;
+  size_t size;
+
+  if (cache->count == cache->size) {
+    size = cache->size ? cache->size * 2 : 16;
+    array = realloc(cache->addr, sizeof(*array) * size);
+    if (array == NULL) {
+      OONF_WARN(LOG_NHDP_W, "Out of memory error for NHDP hello address");
+
+      /* try again for the next HELLO */
+      cache->valid = false;
+      return NULL;
+    }
+    cache->addr = array;
+    cache->size = size;
+  }
+
+  entry = &cache->addr[cache->count++];
+  _init_hello_address(entry);
+  return entry;
+}
+
+/**
+ * Initialize a HELLO address without any TLVs
+ * @param entry HELLO address
+ */
+static void
+_init_hello_address(struct _hello_address *entry) {
+  /* clear padding too, entries are compared with memcmp */
+  memset(entry, 0, sizeof(*entry));
+  entry->localif = 255;
+  entry->linkstatus = 255;
+  entry->otherneigh = 255;
+  memset(entry->mpr, RFC5444_MPR_NOMPR, sizeof(entry->mpr));
+}
+
+/**
+ * Plan a rfc5444 address with localif TLV
+ * @param entry initialized HELLO address to fill
  * @param interf
  * @param addr
  */
 static void
-_add_localif_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_provider *prv,
+_plan_localif_address(struct _hello_address *entry,
     struct nhdp_interface *interf, struct nhdp_interface_addr *addr) {
-  struct rfc5444_writer_address *address;
   struct netaddr_str buf;
-  uint8_t value;
   bool this_if;
 
   /* check if address of local interface */
@@ -318,37 +670,27 @@ _add_localif_address(struct rfc5444_writer *writer, struct rfc5444_writer_conten
   OONF_DEBUG(LOG_NHDP_W, "Add %s (%s) to NHDP hello",
       netaddr_to_string(&buf, &addr->if_addr), this_if ? "this_if" : "other_if");
 
-  /* generate RFC5444 address */
-  address = rfc5444_writer_add_address(writer, prv->creator, &addr->if_addr, true);
-  if (address == NULL) {
-    OONF_WARN(LOG_NHDP_W, "Could not add address %s to NHDP hello",
-        netaddr_to_string(&buf, &addr->if_addr));
-    return;
-  }
+  memcpy(&entry->addr, &addr->if_addr, sizeof(entry->addr));
 
-  /* Add LOCALIF TLV */
+  /* LOCALIF TLV */
   if (this_if) {
-    value = RFC5444_LOCALIF_THIS_IF;
+    entry->localif = RFC5444_LOCALIF_THIS_IF;
   }
   else {
-    value = RFC5444_LOCALIF_OTHER_IF;
+    entry->localif = RFC5444_LOCALIF_OTHER_IF;
   }
-  rfc5444_writer_add_addrtlv(writer, address, &_nhdp_addrtlvs[IDX_ADDRTLV_LOCAL_IF],
-      &value, sizeof(value), true);
 }
 
 /**
- * Add a rfc5444 address with link_status or other_neigh TLV to the stream
- * @param writer
- * @param prv
+ * Plan a rfc5444 address with link_status or other_neigh TLV
+ * @param entry initialized HELLO address to fill
  * @param interf
  * @param naddr
  */
 static void
-_add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_provider *prv,
+_plan_link_address(struct _hello_address *entry,
     struct nhdp_interface *interf, struct nhdp_naddr *naddr) {
   struct nhdp_domain *domain;
-  struct rfc5444_writer_address *address;
   struct nhdp_laddr *laddr;
   struct netaddr_str buf;
   uint8_t linkstatus, otherneigh, mpr;
@@ -370,28 +712,15 @@ _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_p
     }
   }
 
-  /* generate RFC5444 address */
-  address = rfc5444_writer_add_address(writer, prv->creator, &naddr->neigh_addr, true);
-  if (address == NULL) {
-    OONF_WARN(LOG_NHDP_W, "Could not add address %s to NHDP hello",
-        netaddr_to_string(&buf, &naddr->neigh_addr));
-    return;
-  }
+  memcpy(&entry->addr, &naddr->neigh_addr, sizeof(entry->addr));
+  entry->linkstatus = linkstatus;
+  entry->otherneigh = otherneigh;
 
   if (linkstatus != 255) {
-    rfc5444_writer_add_addrtlv(writer, address,
-          &_nhdp_addrtlvs[IDX_ADDRTLV_LINK_STATUS],
-          &linkstatus, sizeof(linkstatus), false);
-
     OONF_DEBUG(LOG_NHDP_W, "Add %s (linkstatus=%d) to NHDP hello",
         netaddr_to_string(&buf, &naddr->neigh_addr), laddr->link->status);
   }
-
   if (otherneigh != 255) {
-    rfc5444_writer_add_addrtlv(writer, address,
-        &_nhdp_addrtlvs[IDX_ADDRTLV_OTHER_NEIGHB],
-        &otherneigh, sizeof(otherneigh), false);
-
     OONF_DEBUG(LOG_NHDP_W, "Add %s (otherneigh=%d) to NHDP hello",
         netaddr_to_string(&buf, &naddr->neigh_addr), otherneigh);
   }
@@ -405,8 +734,7 @@ _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_p
 
       mpr = nhdp_domain_get_mpr_tlvvalue(domain, laddr->link);
       if (mpr != RFC5444_MPR_NOMPR) {
-        rfc5444_writer_add_addrtlv(writer, address,
-            &domain->_mpr_addrtlv, &mpr, sizeof(mpr), false);
+        entry->mpr[domain->index] = mpr;
 
         OONF_DEBUG(LOG_NHDP_W, "Add %s (mpr=%d, etx=%d) to NHDP hello",
             netaddr_to_string(&buf, &naddr->neigh_addr), mpr, domain->ext);
@@ -427,26 +755,25 @@ _add_link_address(struct rfc5444_writer *writer, struct rfc5444_writer_content_p
         || linkstatus == RFC5444_LINKSTATUS_SYMMETRIC) {
       lnk = laddr->link;
     }
-    if (naddr->neigh->symmetric > 0
+    if (naddr->neigh != NULL && naddr->neigh->symmetric > 0
         && (linkstatus == RFC5444_LINKSTATUS_SYMMETRIC
             || otherneigh == RFC5444_OTHERNEIGHB_SYMMETRIC)) {
       neigh = naddr->neigh;
     }
 
-    _write_metric_tlv(writer, address, neigh, lnk, domain);
+    _plan_metric_tlv(entry, neigh, lnk, domain);
   }
 }
 
 /**
- * Write up to four metric TLVs to an address
- * @param writer rfc5444 writer
- * @param addr rfc5444 address
+ * Calculate up to four metric TLVs for an address
+ * @param entry planned HELLO address
  * @param neigh pointer to symmetric neighbor, might be NULL
  * @param lnk pointer to symmetric link, might be NULL
  * @param handler pointer to link metric handler
  */
 static void
-_write_metric_tlv(struct rfc5444_writer *writer, struct rfc5444_writer_address *addr,
+_plan_metric_tlv(struct _hello_address *entry,
     struct nhdp_neighbor *neigh, struct nhdp_link *lnk,
     struct nhdp_domain *domain) {
   static const uint16_t flags[4] = {
@@ -460,7 +787,7 @@ _write_metric_tlv(struct rfc5444_writer *writer, struct rfc5444_writer_address *
   bool unsent[4];
   uint32_t metrics[4];
   uint16_t tlv_value;
-  int i,j,k;
+  int i,j;
 
   if (lnk == NULL && neigh == NULL) {
     /* nothing to do */
@@ -498,7 +825,6 @@ _write_metric_tlv(struct rfc5444_writer *writer, struct rfc5444_writer_address *
   }
 
   /* compress four metrics into 1-4 TLVs */
-  k = 0;
   for (i=0; i<4; i++) {
     /* find first metric value which still must be sent */
     if (!unsent[i]) {
@@ -520,46 +846,411 @@ _write_metric_tlv(struct rfc5444_writer *writer, struct rfc5444_writer_address *
         rfc5444_metric_decode(metrics[i]));
 
     /* conversion into network byte order */
-    tlv_value = htons(tlv_value);
+    entry->metric[domain->index][i] = htons(tlv_value);
+    entry->metric_slots[domain->index] |= 1 << i;
+  }
+}
+
+/**
+ * Add a planned address and its TLVs to the stream
+ * @param writer
+ * @param prv
+ * @param entry
+ */
+static void
+_write_hello_address(struct rfc5444_writer *writer,
+    struct rfc5444_writer_content_provider *prv,
+    struct _hello_address *entry) {
+  struct rfc5444_writer_address *address;
+  struct nhdp_domain *domain;
+  struct netaddr_str buf;
+  int i;
+
+  /* generate RFC5444 address */
+  address = rfc5444_writer_add_address(writer, prv->creator, &entry->addr, true);
+  if (address == NULL) {
+    OONF_WARN(LOG_NHDP_W, "Could not add address %s to NHDP hello",
+        netaddr_to_string(&buf, &entry->addr));
+    return;
+  }
+
+  if (entry->localif != 255) {
+    rfc5444_writer_add_addrtlv(writer, address, &_nhdp_addrtlvs[IDX_ADDRTLV_LOCAL_IF],
+        &entry->localif, sizeof(entry->localif), true);
+  }
+
+  if (entry->linkstatus != 255) {
+    rfc5444_writer_add_addrtlv(writer, address,
+          &_nhdp_addrtlvs[IDX_ADDRTLV_LINK_STATUS],
+          &entry->linkstatus, sizeof(entry->linkstatus), false);
+  }
+
+  if (entry->otherneigh != 255) {
+    rfc5444_writer_add_addrtlv(writer, address,
+        &_nhdp_addrtlvs[IDX_ADDRTLV_OTHER_NEIGHB],
+        &entry->otherneigh, sizeof(entry->otherneigh), false);
+  }
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    /* add MPR tlv */
+    if (entry->mpr[domain->index] != RFC5444_MPR_NOMPR) {
+      rfc5444_writer_add_addrtlv(writer, address, &domain->_mpr_addrtlv,
+          &entry->mpr[domain->index], sizeof(entry->mpr[0]), false);
+    }
+
+    /*
+     * add linkcost TLVs, only allow duplicates for the additional
+     * metrics of a domain so the RFC5444 writer can merge the TLVs
+     * of neighboring addresses
+     */
+    for (i=0; i<4; i++) {
+      if ((entry->metric_slots[domain->index] & (1 << i)) == 0) {
+        continue;
+      }
+      rfc5444_writer_add_addrtlv(writer, address,
+          &domain->_metric_addrtlvs[i],
+          &entry->metric[domain->index][i], sizeof(entry->metric[0][0]),
+          (entry->metric_slots[domain->index] & ((1 << i) - 1)) != 0);
+    }
+  }
+}
 
-    /* add to rfc5444 address */
-    rfc5444_writer_add_addrtlv(writer, addr,
-        &domain->_metric_addrtlvs[k++],
-        &tlv_value, sizeof(tlv_value), true);
+/**
+ * Callback for qsort to order the addresses of a HELLO. Addresses are
+ * grouped by their network part first, then by identical TLV values
+ * and finally by the address itself, which allows the RFC5444 writer
+ * to use long common heads and single value TLVs over address ranges.
+ * @param p1 pointer to first hello address
+ * @param p2 pointer to second hello address
+ * @return <0, 0 or >0 like memcmp()
+ */
+static int
+_cb_compare_hello_address(const void *p1, const void *p2) {
+  const struct _hello_address *a1 = p1, *a2 = p2;
+  int result;
+
+  result = nhdp_writer_compare_address_group(&a1->addr, &a2->addr);
+  if (result == 0) {
+    result = memcmp(&a1->localif, &a2->localif,
+        sizeof(*a1) - offsetof(struct _hello_address, localif));
+  }
+  if (result == 0) {
+    result = netaddr_cmp(&a1->addr, &a2->addr);
   }
+  return result;
 }
+
 /**
- * Callback to add the addresses and address TLVs to a HELLO message
+ * Callback to add the addresses and address TLVs to a HELLO message.
+ * The ordered addresses are only collected again if the NHDP
+ * database changed in a way that affects the HELLO, they are not
+ * ordered at all if this cannot make the HELLO smaller.
  * @param writer
  */
 void
 _cb_addAddresses(struct rfc5444_writer *writer) {
   struct oonf_rfc5444_target *target;
-
   struct nhdp_interface *interf;
-  struct nhdp_interface_addr *addr;
-  struct nhdp_naddr *naddr;
+  struct _hello_interface *hello;
+  struct _hello_cache *cache;
+  int af_type;
+  size_t i;
 
   /* have already be checked for message TLVs, so they cannot be NULL */
   target = oonf_rfc5444_get_target_from_writer(writer);
   interf = nhdp_interface_get(target->interface->name);
 
-  /* transmit interface addresses first */
+  af_type = netaddr_get_address_family(&target->dst);
+
+  if (!_hello_order_useful()) {
+    _write_unordered_hello(writer, interf, af_type);
+    return;
+  }
+
+  hello = oonf_class_get_extension(&_interface_extension, interf);
+  cache = &hello->cache[af_type == AF_INET ? 0 : 1];
+
+  if (!cache->valid) {
+    OONF_DEBUG(LOG_NHDP_W, "Plan IPv%d hello addresses of interface %s",
+        af_type == AF_INET ? 4 : 6, nhdp_interface_get_name(interf));
+    _plan_hello(cache, interf, af_type);
+  }
+
+  for (i=0; i<cache->count; i++) {
+    _write_hello_address(writer, &_nhdp_msgcontent_provider, &cache->addr[i]);
+  }
+}
+
+/**
+ * Add the addresses of a HELLO in database order, without collecting
+ * and sorting them first.
+ * @param writer
+ * @param interf NHDP interface the HELLO is generated for
+ * @param af_type address family of the HELLO
+ */
+static void
+_write_unordered_hello(struct rfc5444_writer *writer,
+    struct nhdp_interface *interf, int af_type) {
+  struct nhdp_interface_addr *addr;
+  struct nhdp_naddr *naddr;
+  struct _hello_address entry;
+
   avl_for_each_element(&nhdp_ifaddr_tree, addr, _global_node) {
-    if (addr->removed) {
+    if (addr->removed
+        || netaddr_get_address_family(&addr->if_addr) != af_type) {
       continue;
     }
-    if (netaddr_get_address_family(&addr->if_addr)
-        == netaddr_get_address_family(&target->dst)) {
-      _add_localif_address(writer, &_nhdp_msgcontent_provider, interf, addr);
-    }
+    _init_hello_address(&entry);
+    _plan_localif_address(&entry, interf, addr);
+    _write_hello_address(writer, &_nhdp_msgcontent_provider, &entry);
   }
 
-  /* then transmit neighbor addresses */
   avl_for_each_element(&nhdp_naddr_tree, naddr, _global_node) {
-    if (netaddr_get_address_family(&naddr->neigh_addr)
-        == netaddr_get_address_family(&target->dst)) {
-      _add_link_address(writer, &_nhdp_msgcontent_provider, interf, naddr);
+    if (netaddr_get_address_family(&naddr->neigh_addr) != af_type) {
+      continue;
     }
+    _init_hello_address(&entry);
+    _plan_link_address(&entry, interf, naddr);
+    _write_hello_address(writer, &_nhdp_msgcontent_provider, &entry);
+  }
+}
+
+/**
+ * Ordering the addresses of a HELLO only pays off if many of them
+ * share their TLV values. A metric with a continuous range gives most
+ * links a different cost, so neither the buffer nor the qsort is
+ * worth it.
+ * @return true if the HELLO addresses should be ordered
+ */
+static bool
+_hello_order_useful(void) {
+  struct nhdp_domain *domain;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    if (!domain->metric->no_default_handling
+        && domain->metric->metric_minimum < domain->metric->metric_maximum) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Mark the cached HELLO addresses of an interface as outdated
+ * @param interf NHDP interface
+ */
+static void
+_invalidate_interface(struct nhdp_interface *interf) {
+  struct _hello_interface *hello;
+
+  hello = oonf_class_get_extension(&_interface_extension, interf);
+  hello->cache[0].valid = false;
+  hello->cache[1].valid = false;
+}
+
+/**
+ * Mark the cached HELLO addresses of all interfaces as outdated
+ */
+static void
+_invalidate_all(void) {
+  struct nhdp_interface *interf;
+
+  avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+    _invalidate_interface(interf);
+  }
+}
+
+/**
+ * Check if the HELLO relevant state of a neighbor or one of its
+ * links changed and invalidate the affected HELLOs
+ * @param neigh NHDP neighbor
+ */
+static void
+_check_neighbor(struct nhdp_neighbor *neigh) {
+  struct nhdp_link *lnk;
+
+  /* neighbor state is advertised on all interfaces */
+  if (_neighbor_state_changed(neigh)) {
+    _invalidate_all();
+  }
+
+  list_for_each_element(&neigh->_links, lnk, _neigh_node) {
+    if (_link_state_changed(lnk)) {
+      _invalidate_interface(lnk->local_if);
+    }
+  }
+}
+
+/**
+ * Compare the HELLO relevant state of a link with the state
+ * of the last check and remember the current one
+ * @param lnk NHDP link
+ * @return true if the state changed
+ */
+static bool
+_link_state_changed(struct nhdp_link *lnk) {
+  struct _hello_link *state;
+  struct nhdp_domain *domain;
+  struct nhdp_link_domaindata *data;
+  bool changed;
+
+  state = oonf_class_get_extension(&_link_extension, lnk);
+
+  changed = state->status != lnk->status;
+  state->status = lnk->status;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    data = nhdp_domain_get_linkdata(domain, lnk);
+    if (memcmp(&state->metric[domain->index],
+        &data->metric, sizeof(data->metric)) != 0) {
+      memcpy(&state->metric[domain->index], &data->metric, sizeof(data->metric));
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/**
+ * Compare the HELLO relevant state of a neighbor with the state
+ * of the last check and remember the current one
+ * @param neigh NHDP neighbor
+ * @return true if the state changed
+ */
+static bool
+_neighbor_state_changed(struct nhdp_neighbor *neigh) {
+  struct _hello_neighbor *state;
+  struct nhdp_domain *domain;
+  struct nhdp_neighbor_domaindata *data;
+  bool changed;
+
+  state = oonf_class_get_extension(&_neighbor_extension, neigh);
+
+  changed = _mpr_state_changed(neigh)
+      || state->symmetric != (neigh->symmetric > 0);
+  state->symmetric = neigh->symmetric > 0;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    data = nhdp_domain_get_neighbordata(domain, neigh);
+    if (memcmp(&state->metric[domain->index],
+        &data->metric, sizeof(data->metric)) != 0) {
+      memcpy(&state->metric[domain->index], &data->metric, sizeof(data->metric));
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/**
+ * Compare the MPR selection of a neighbor with the state
+ * of the last check and remember the current one
+ * @param neigh NHDP neighbor
+ * @return true if the MPR selection changed
+ */
+static bool
+_mpr_state_changed(struct nhdp_neighbor *neigh) {
+  struct _hello_neighbor *state;
+  struct nhdp_domain *domain;
+  struct nhdp_neighbor_domaindata *data;
+  bool changed;
+
+  state = oonf_class_get_extension(&_neighbor_extension, neigh);
+
+  changed = state->flooding_mpr != neigh->neigh_is_flooding_mpr;
+  state->flooding_mpr = neigh->neigh_is_flooding_mpr;
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    data = nhdp_domain_get_neighbordata(domain, neigh);
+    if (state->mpr[domain->index] != data->neigh_is_mpr) {
+      state->mpr[domain->index] = data->neigh_is_mpr;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/**
+ * Callback triggered when a NHDP interface is removed
+ * @param ptr NHDP interface
+ */
+static void
+_cb_interface_removed(void *ptr) {
+  struct _hello_interface *hello;
+  int i;
+
+  hello = oonf_class_get_extension(&_interface_extension, ptr);
+  for (i=0; i<2; i++) {
+    free(hello->cache[i].addr);
+    memset(&hello->cache[i], 0, sizeof(hello->cache[i]));
+  }
+}
+
+/**
+ * Callback triggered when the status of a NHDP link changed
+ * @param ptr NHDP link
+ */
+static void
+_cb_link_changed(void *ptr) {
+  struct nhdp_link *lnk = ptr;
+
+  _check_neighbor(lnk->neigh);
+}
+
+/**
+ * Callback triggered when a NHDP link address is added, moved
+ * or removed
+ * @param ptr NHDP link address
+ */
+static void
+_cb_laddr_changed(void *ptr) {
+  struct nhdp_laddr *laddr = ptr;
+
+  _invalidate_interface(laddr->link->local_if);
+}
+
+/**
+ * Callback triggered when a NHDP database change might affect
+ * the HELLOs of all interfaces
+ * @param ptr unused
+ */
+static void
+_cb_neighborhood_changed(void *ptr __attribute__((unused))) {
+  _invalidate_all();
+}
+
+/**
+ * Callback triggered when the metric or MPR settings of a
+ * NHDP neighbor (or the whole neighborhood) changed
+ * @param neigh pointer to NHDP neighbor, NULL if all neighbors
+ *   might have changed
+ */
+static void
+_cb_nhdp_update(struct nhdp_neighbor *neigh) {
+  struct nhdp_neighbor *n;
+
+  if (neigh == NULL) {
+    list_for_each_element(&nhdp_neigh_list, n, _global_node) {
+      _check_neighbor(n);
+    }
+    return;
+  }
+
+  _check_neighbor(neigh);
+
+  /* a new MPR calculation might have changed every MPR selection */
+  list_for_each_element(&nhdp_neigh_list, n, _global_node) {
+    if (_mpr_state_changed(n)) {
+      _invalidate_all();
+    }
+  }
+}
+
+/**
+ * Callback triggered when the incoming metric of a link changed
+ * @param lnk NHDP link
+ */
+static void
+_cb_nhdp_link_update(struct nhdp_link *lnk) {
+  if (_link_state_changed(lnk)) {
+    _invalidate_interface(lnk->local_if);
   }
 }
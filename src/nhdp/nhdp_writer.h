@@ -43,6 +43,7 @@
 #define NHDP_WRITER_H_
 
 #include "common/common_types.h"
+#include "common/netaddr.h"
 #include "subsystems/oonf_rfc5444.h"
 
 int nhdp_writer_init(struct oonf_rfc5444_protocol *)
@@ -51,5 +52,7 @@ void nhdp_writer_initiate_shutdown(void);
 void nhdp_writer_cleanup(void);
 
 EXPORT void nhdp_writer_send_hello(struct nhdp_interface *interf);
+EXPORT int nhdp_writer_compare_address_group(
+    const struct netaddr *, const struct netaddr *);
 
 #endif /* NHDP_WRITER_H_ */
@@ -51,6 +51,7 @@
 #include "core/oonf_logging.h"
 #include "core/oonf_subsystem.h"
 #include "core/os_core.h"
+#include "subsystems/oonf_clock.h"
 #include "subsystems/oonf_rfc5444.h"
 #include "subsystems/oonf_telnet.h"
 #include "subsystems/oonf_timer.h"
@@ -58,6 +59,7 @@
 #include "nhdp/nhdp_interfaces.h"
 
 #include "olsrv2/olsrv2.h"
+#include "olsrv2/olsrv2_duplicate.h"
 #include "olsrv2/olsrv2_lan.h"
 #include "olsrv2/olsrv2_originator.h"
 #include "olsrv2/olsrv2_reader.h"
@@ -75,11 +77,19 @@
 struct _config {
   uint64_t tc_interval;
   uint64_t tc_validity;
+  uint64_t tc_max_interval;
+  uint64_t tc_trigger_interval;
+  uint64_t hello_aggregation;
 
   uint64_t f_hold_time;
   uint64_t p_hold_time;
   struct netaddr_acl routable;
 
+  /* size limits of topology database */
+  int32_t tc_max_nodes;
+  int32_t tc_max_edges;
+  int32_t tc_max_endpoints;
+
   /* configuration for originator set */
   struct netaddr_acl originator_v4_acl;
   struct netaddr_acl originator_v6_acl;
@@ -142,6 +152,18 @@ static struct cfg_schema_entry _olsrv2_entries[] = {
     "Time between two TC messages", 100),
   CFG_MAP_CLOCK_MIN(_config, tc_validity, "tc_validity", "300.0",
     "Validity time of a TC messages", 100),
+  CFG_MAP_CLOCK(_config, tc_max_interval, "tc_max_interval", "0",
+    "Maximum time between two TC messages if the local topology is stable,"
+    " values up to the tc_interval disable the adaptive TC interval."
+    " A larger maximum reduces the TC overhead of a stable network, but the"
+    " validity time of TCs is scaled with the current interval, so stale"
+    " topology information of a vanished router stays longer in the"
+    " database of the other routers."),
+  CFG_MAP_CLOCK_MIN(_config, tc_trigger_interval, "tc_trigger_interval", "1.0",
+    "Minimum time between two TC messages triggered by a topology change", 100),
+  CFG_MAP_CLOCK(_config, hello_aggregation, "hello_aggregation", "0.5",
+    "HELLOs due within this time after a TC are sent together with the TC"
+    " to share its RFC5444 packet, 0 to disable"),
   CFG_MAP_CLOCK_MIN(_config, f_hold_time, "forward_hold_time", "300.0",
     "Holdtime for forwarding set information", 100),
     CFG_MAP_CLOCK_MIN(_config, p_hold_time, "processing_hold_time", "300.0",
@@ -149,6 +171,17 @@ static struct cfg_schema_entry _olsrv2_entries[] = {
   CFG_MAP_ACL_V46(_config, routable, "routable",
       OLSRV2_ROUTABLE_IPV4 OLSRV2_ROUTABLE_IPV6 ACL_DEFAULT_ACCEPT,
     "Filter to decide which addresses are considered routable"),
+  CFG_MAP_INT32_MINMAX(_config, tc_max_nodes, "tc_max_nodes", "4096",
+    "Maximum number of nodes in the topology database, 0 for no limit",
+    0, false, 0, INT32_MAX),
+  CFG_MAP_INT32_MINMAX(_config, tc_max_edges, "tc_max_edges", "256",
+    "Maximum number of edges and attachments of a single node in the"
+    " topology database, 0 for no limit",
+    0, false, 0, INT32_MAX),
+  CFG_MAP_INT32_MINMAX(_config, tc_max_endpoints, "tc_max_endpoints", "16384",
+    "Maximum number of attached networks and addresses in the topology"
+    " database, 0 for no limit",
+    0, false, 0, INT32_MAX),
 
   CFG_VALIDATE_LAN(_LOCAL_ATTACHED_NETWORK_KEY, "",
     "locally attached network, a combination of an"
@@ -187,7 +220,6 @@ static struct _config _olsrv2_config;
 /* timer for TC generation */
 static struct oonf_timer_info _tc_timer_class = {
   .name = "TC generation",
-  .periodic = true,
   .callback = _cb_generate_tc,
 };
 
@@ -205,6 +237,14 @@ static struct oonf_rfc5444_protocol *_protocol;
 
 static uint16_t _ansn;
 
+/* true if the advertised topology changed since the last ANSN update */
+static bool _ansn_changed = false;
+
+/* adaptive TC interval */
+static uint64_t _current_tc_interval;
+static uint64_t _last_tc = 0;
+static bool _tc_triggered = false;
+
 /* Additional logging sources */
 enum oonf_log_source LOG_OLSRV2_R;
 enum oonf_log_source LOG_OLSRV2_W;
@@ -242,6 +282,7 @@ _init(void) {
   oonf_interface_add_listener(&_if_listener);
 
   /* activate the rest of the olsrv2 protocol */
+  olsrv2_duplicate_init();
   olsrv2_lan_init();
   olsrv2_originator_init();
   olsrv2_reader_init(_protocol);
@@ -281,6 +322,10 @@ _cleanup(void) {
     oonf_telnet_remove(&_cmds[i]);
   }
 
+  /* stop TC generation */
+  oonf_timer_stop(&_tc_timer);
+  oonf_timer_remove(&_tc_timer_class);
+
   /* remove interface listener */
   oonf_interface_remove_listener(&_if_listener);
 
@@ -294,25 +339,68 @@ _cleanup(void) {
   olsrv2_originator_cleanup();
   olsrv2_tc_cleanup();
   olsrv2_lan_cleanup();
+  olsrv2_duplicate_cleanup();
 
   /* free protocol instance */
   oonf_rfc5444_remove_protocol(_protocol);
 }
 
 /**
- * @return interval between two tcs
+ * @return current interval between two tcs
  */
 uint64_t
 olsrv2_get_tc_interval(void) {
-  return _olsrv2_config.tc_interval;
+  return _current_tc_interval;
 }
 
 /**
- * @return validity of the local TCs
+ * @return validity of the local TCs, scaled with the current tc interval
  */
 uint64_t
 olsrv2_get_tc_validity(void) {
-  return _olsrv2_config.tc_validity;
+  return _olsrv2_config.tc_validity
+      * _current_tc_interval / _olsrv2_config.tc_interval;
+}
+
+/**
+ * @return validity of the local TCs at the maximum tc interval
+ */
+uint64_t
+olsrv2_get_tc_max_validity(void) {
+  return _olsrv2_config.tc_validity
+      * _olsrv2_config.tc_max_interval / _olsrv2_config.tc_interval;
+}
+
+/**
+ * Trigger a TC because the advertised topology changed. The TC is
+ * sent after the tc_trigger_interval since the last TC has passed
+ * and the TC interval is reset to its minimum.
+ */
+void
+olsrv2_trigger_tc(void) {
+  uint64_t delay, now;
+
+  _ansn_changed = true;
+
+  if (_tc_triggered || _olsrv2_config.tc_interval == 0) {
+    /* TC already scheduled or not configured yet */
+    return;
+  }
+  _tc_triggered = true;
+
+  /* rate limit triggered TCs */
+  now = oonf_clock_getNow();
+  if (_last_tc + _olsrv2_config.tc_trigger_interval > now) {
+    delay = _last_tc + _olsrv2_config.tc_trigger_interval - now;
+  }
+  else {
+    delay = 1;
+  }
+
+  if (!oonf_timer_is_active(&_tc_timer)
+      || oonf_timer_get_due(&_tc_timer) > delay) {
+    oonf_timer_set(&_tc_timer, delay);
+  }
 }
 
 /**
@@ -333,7 +421,6 @@ olsrv2_get_routable(void) {
 bool
 olsrv2_mpr_shall_process(
     struct rfc5444_reader_tlvblock_context *context, uint64_t vtime) {
-  enum oonf_duplicate_result dup_result;
   bool process;
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
@@ -347,18 +434,17 @@ olsrv2_mpr_shall_process(
     return false;
   }
 
-  /* check forwarding set */
-  dup_result = oonf_duplicate_entry_add(&_protocol->processed_set,
-      context->msg_type, &context->orig_addr,
-      context->seqno, vtime + _olsrv2_config.f_hold_time);
-  process = oonf_duplicate_is_new(dup_result);
+  /* check processing set */
+  process = olsrv2_duplicate_add(context->msg_type, &context->orig_addr,
+      context->seqno, OLSRV2_DUPLICATE_PROCESS,
+      vtime + _olsrv2_config.p_hold_time) != 0;
 
   OONF_DEBUG(LOG_OLSRV2, "Do %sprocess message type %u from %s"
-      " with seqno %u (dupset result: %u)",
+      " with seqno %u",
       process ? "" : "not ",
       context->msg_type,
       netaddr_to_string(&buf, &context->orig_addr),
-      context->seqno, dup_result);
+      context->seqno);
   return process;
 }
 
@@ -372,11 +458,6 @@ olsrv2_mpr_shall_process(
 bool
 olsrv2_mpr_shall_forwarding(
     struct rfc5444_reader_tlvblock_context *context, uint64_t vtime) {
-  struct nhdp_interface *interf;
-  struct nhdp_laddr *laddr;
-  struct nhdp_neighbor *neigh;
-  enum oonf_duplicate_result dup_result;
-  bool forward;
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
 #endif
@@ -389,18 +470,41 @@ olsrv2_mpr_shall_forwarding(
     return false;
   }
 
+  /* only copies from flooding MPR selectors enter the forwarding set */
+  if (!olsrv2_mpr_is_forwarding_selector(context)) {
+    return false;
+  }
+
   /* check forwarding set */
-  dup_result = oonf_duplicate_entry_add(&_protocol->forwarded_set,
-      context->msg_type, &context->orig_addr,
-      context->seqno, vtime + _olsrv2_config.f_hold_time);
-  if (!oonf_duplicate_is_new(dup_result)) {
+  if (olsrv2_duplicate_add(context->msg_type, &context->orig_addr,
+      context->seqno, OLSRV2_DUPLICATE_FORWARD,
+      vtime + _olsrv2_config.f_hold_time) == 0) {
     OONF_DEBUG(LOG_OLSRV2, "Do not forward message type %u from %s"
-        " with seqno %u (dupset result: %u)",
+        " with seqno %u (duplicate)",
         context->msg_type,
         netaddr_to_string(&buf, &context->orig_addr),
-        context->seqno, dup_result);
+        context->seqno);
     return false;
   }
+  return true;
+}
+
+/**
+ * Check if a message was received from a neighbor that selected us
+ * as a flooding MPR.
+ * @param context rfc5444 context of message
+ * @return true if message should be forwarded
+ */
+bool
+olsrv2_mpr_is_forwarding_selector(
+    struct rfc5444_reader_tlvblock_context *context) {
+  struct nhdp_interface *interf;
+  struct nhdp_laddr *laddr;
+  struct nhdp_neighbor *neigh;
+  bool forward;
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
 
   /* check input interface */
   if (_protocol->input_interface == NULL) {
@@ -415,7 +519,7 @@ olsrv2_mpr_shall_forwarding(
   }
 
   /* get NHDP interface */
-  interf = nhdp_interface_get(_protocol->input_interface->name);
+  interf = nhdp_interface_get_input();
   if (interf == NULL) {
     OONF_DEBUG(LOG_OLSRV2, "Do not forward because NHDP does not handle"
         " interface '%s'", _protocol->input_interface->name);
@@ -423,7 +527,7 @@ olsrv2_mpr_shall_forwarding(
   }
 
   /* get NHDP link address corresponding to source */
-  laddr = nhdp_interface_get_link_addr(interf, _protocol->input_address);
+  laddr = nhdp_interface_get_input_laddr(interf);
   if (laddr == NULL) {
     OONF_DEBUG(LOG_OLSRV2, "Do not forward because source IP %s is"
         " not a direct neighbor",
@@ -445,6 +549,57 @@ olsrv2_mpr_shall_forwarding(
   return forward;
 }
 
+/**
+ * Combined processing and forwarding check of a message,
+ * which needs only a single duplicate set lookup.
+ * @param context rfc5444 context of message
+ * @param vtime validity time of message
+ * @param process set to true if message should be processed
+ * @param forward set to true if message should be forwarded
+ */
+void
+olsrv2_mpr_check_message(struct rfc5444_reader_tlvblock_context *context,
+    uint64_t vtime, bool *process, bool *forward) {
+  uint64_t hold_time;
+  int flags, new_flags;
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
+
+  *process = false;
+  *forward = false;
+
+  /* check if message has originator and sequence number */
+  if (!context->has_origaddr || !context->has_seqno) {
+    OONF_DEBUG(LOG_OLSRV2, "Do not process or forward message type %u,"
+        " originator or sequence number is missing!",
+        context->msg_type);
+    return;
+  }
+
+  /* one entry holds both sets, so use the longer hold time */
+  hold_time = _olsrv2_config.f_hold_time;
+  if (hold_time < _olsrv2_config.p_hold_time) {
+    hold_time = _olsrv2_config.p_hold_time;
+  }
+
+  flags = olsrv2_duplicate_get_flags(
+      olsrv2_mpr_is_forwarding_selector(context));
+
+  new_flags = olsrv2_duplicate_add(context->msg_type, &context->orig_addr,
+      context->seqno, flags, vtime + hold_time);
+
+  *process = (new_flags & OLSRV2_DUPLICATE_PROCESS) != 0;
+  *forward = (new_flags & OLSRV2_DUPLICATE_FORWARD) != 0;
+
+  OONF_DEBUG(LOG_OLSRV2, "Do %sprocess and %sforward message type %u"
+      " from %s with seqno %u",
+      *process ? "" : "not ", *forward ? "" : "not ",
+      context->msg_type,
+      netaddr_to_string(&buf, &context->orig_addr),
+      context->seqno);
+}
+
 /**
  * @return current answer set number for local topology database
  */
@@ -470,8 +625,9 @@ olsrv2_update_ansn(void) {
     }
   }
 
-  if (changed) {
+  if (changed || _ansn_changed) {
     _ansn++;
+    _ansn_changed = false;
   }
   return _ansn;
 }
@@ -637,7 +793,35 @@ _parse_lan_array(struct cfg_named_section *section, bool add) {
  */
 static void
 _cb_generate_tc(void *ptr __attribute__((unused))) {
+  struct nhdp_interface *interf;
+
+  /* check if the advertised topology changed since the last TC */
+  olsrv2_writer_update_tc();
+
+  if (_tc_triggered) {
+    /* topology changed, go back to the fast TC interval */
+    _current_tc_interval = _olsrv2_config.tc_interval;
+    _tc_triggered = false;
+  }
+  else if (_current_tc_interval < _olsrv2_config.tc_max_interval) {
+    /* topology is stable, slowly increase the TC interval */
+    _current_tc_interval += _current_tc_interval / 2;
+    if (_current_tc_interval > _olsrv2_config.tc_max_interval) {
+      _current_tc_interval = _olsrv2_config.tc_max_interval;
+    }
+  }
+
+  _last_tc = oonf_clock_getNow();
   olsrv2_writer_send_tc();
+
+  if (_olsrv2_config.hello_aggregation > 0) {
+    /* pull HELLOs forward so they end up in the same packet as the TC */
+    avl_for_each_element(&nhdp_interface_tree, interf, _node) {
+      nhdp_interface_send_hello_early(interf, _olsrv2_config.hello_aggregation);
+    }
+  }
+
+  oonf_timer_set(&_tc_timer, _current_tc_interval);
 }
 
 /**
@@ -670,7 +854,8 @@ _cb_topology(struct oonf_telnet_data *con) {
 
       list_for_each_element(&nhdp_domain_list, domain, _node) {
         abuf_appendf(con->out, "\t\tmetric '%s': %d\n",
-            domain->metric->name, edge->cost[domain->index]);
+            domain->metric->name,
+            olsrv2_tc_edge_get_domaindata(domain, edge)->cost);
       }
     }
 
@@ -681,7 +866,8 @@ _cb_topology(struct oonf_telnet_data *con) {
 
         list_for_each_element(&nhdp_domain_list, domain, _node) {
           abuf_appendf(con->out, "\t\tmetric '%s': %d\n",
-              domain->metric->name, end->cost[domain->index]);
+              domain->metric->name,
+              olsrv2_tc_attachment_get_domaindata(domain, end)->cost);
         }
     }
   }
@@ -772,9 +958,23 @@ _cb_cfg_olsrv2_changed(void) {
     return;
   }
 
-  /* set tc timer interval */
+  if (_olsrv2_config.tc_max_interval < _olsrv2_config.tc_interval) {
+    /* a maximum below the tc interval disables the adaptive interval */
+    _olsrv2_config.tc_max_interval = _olsrv2_config.tc_interval;
+  }
+
+  /* restart adaptive tc interval */
+  _current_tc_interval = _olsrv2_config.tc_interval;
+  _tc_triggered = false;
   oonf_timer_set(&_tc_timer, _olsrv2_config.tc_interval);
 
+  /* set limits of topology database */
+  olsrv2_tc_set_limits(_olsrv2_config.tc_max_nodes,
+      _olsrv2_config.tc_max_edges, _olsrv2_config.tc_max_endpoints);
+
+  /* routable ACL might have changed */
+  olsrv2_writer_invalidate_tc();
+
   /* check if we have to change the originators */
   _update_originators();
 
@@ -65,11 +65,18 @@ EXPORT extern enum oonf_log_source LOG_OLSRV2_ROUTING;
 
 EXPORT uint64_t olsrv2_get_tc_interval(void);
 EXPORT uint64_t olsrv2_get_tc_validity(void);
+EXPORT uint64_t olsrv2_get_tc_max_validity(void);
+EXPORT void olsrv2_trigger_tc(void);
 EXPORT const struct netaddr_acl *olsrv2_get_routable(void);
 EXPORT bool olsrv2_mpr_shall_process(
     struct rfc5444_reader_tlvblock_context *, uint64_t vtime);
 EXPORT bool olsrv2_mpr_shall_forwarding(
     struct rfc5444_reader_tlvblock_context *context, uint64_t vtime);
+EXPORT bool olsrv2_mpr_is_forwarding_selector(
+    struct rfc5444_reader_tlvblock_context *context);
+EXPORT void olsrv2_mpr_check_message(
+    struct rfc5444_reader_tlvblock_context *context, uint64_t vtime,
+    bool *process, bool *forward);
 EXPORT uint16_t olsrv2_get_ansn(void);
 EXPORT uint16_t olsrv2_update_ansn(void);
 EXPORT int olsrv2_validate_lan(const struct cfg_schema_entry *entry,
@@ -80,7 +87,7 @@ EXPORT int olsrv2_validate_lan(const struct cfg_schema_entry *entry,
  */
 static INLINE uint64_t
 olsrv2_get_old_originator_validity(void) {
-  return olsrv2_get_tc_validity() * 2;
+  return olsrv2_get_tc_max_validity() * 2;
 }
 
 #endif /* OLSRV2_H_ */
@@ -0,0 +1,263 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#include "common/avl.h"
+#include "common/common_types.h"
+#include "common/netaddr.h"
+#include "subsystems/oonf_class.h"
+#include "subsystems/oonf_timer.h"
+
+#include "olsrv2/olsrv2_duplicate.h"
+
+static struct olsrv2_duplicate_entry *_get_entry(
+    struct olsrv2_duplicate_key *key,
+    uint8_t msg_type, const struct netaddr *originator);
+static void _cb_vtime(void *);
+static int _avl_comp_duplicate(const void *, const void *);
+
+/* duplicate set class and timer */
+static struct oonf_class _duplicate_class = {
+  .name = "olsrv2 duplicate set",
+  .size = sizeof(struct olsrv2_duplicate_entry),
+};
+
+static struct oonf_timer_info _vtime_info = {
+  .name = "olsrv2 duplicate set vtime",
+  .callback = _cb_vtime,
+};
+
+/* tree of duplicate set entries */
+static struct avl_tree _duplicate_tree;
+
+/**
+ * Initialize olsrv2 duplicate set
+ */
+void
+olsrv2_duplicate_init(void) {
+  oonf_class_add(&_duplicate_class);
+  oonf_timer_add(&_vtime_info);
+
+  avl_init(&_duplicate_tree, _avl_comp_duplicate, false);
+}
+
+/**
+ * Cleanup all resources allocated by the duplicate set
+ */
+void
+olsrv2_duplicate_cleanup(void) {
+  struct olsrv2_duplicate_entry *entry, *e_it;
+
+  avl_for_each_element_safe(&_duplicate_tree, entry, _node, e_it) {
+    _cb_vtime(entry);
+  }
+
+  oonf_timer_remove(&_vtime_info);
+  oonf_class_remove(&_duplicate_class);
+}
+
+/**
+ * Record that a message has been checked for processing and/or
+ * forwarding. Both checks of a message share one lookup and one
+ * validity timer.
+ * @param msg_type message type
+ * @param originator originator address of message
+ * @param seqno message sequence number
+ * @param flags bitmask of olsrv2_duplicate_flags to record
+ * @param vtime validity time of the duplicate entry
+ * @return bitmask of the requested flags that had not been
+ *   recorded before for this message
+ */
+int
+olsrv2_duplicate_add(uint8_t msg_type, const struct netaddr *originator,
+    uint16_t seqno, int flags, uint64_t vtime) {
+  struct olsrv2_duplicate_key key;
+  struct olsrv2_duplicate_entry *entry;
+  uint32_t bit;
+  int diff, new_flags;
+
+  entry = _get_entry(&key, msg_type, originator);
+  if (entry == NULL) {
+    entry = oonf_class_malloc(&_duplicate_class);
+    if (entry == NULL) {
+      /* better handle the message twice than not at all */
+      return flags;
+    }
+
+    memcpy(&entry->key, &key, sizeof(key));
+    entry->_node.key = &entry->key;
+    avl_insert(&_duplicate_tree, &entry->_node);
+
+    entry->current = seqno;
+    entry->_vtime.info = &_vtime_info;
+    entry->_vtime.cb_context = entry;
+  }
+
+  diff = (int16_t)(seqno - entry->current);
+  if (diff > 0) {
+    /* newer sequence number, move the window */
+    if (diff >= OLSRV2_DUPLICATE_WINDOW) {
+      entry->processed = 0;
+      entry->forwarded = 0;
+    }
+    else {
+      entry->processed <<= diff;
+      entry->forwarded <<= diff;
+    }
+    entry->current = seqno;
+    diff = 0;
+  }
+  else if (-diff >= OLSRV2_DUPLICATE_WINDOW) {
+    if (++entry->too_old_count <= OLSRV2_DUPLICATE_MAX_TOO_OLD) {
+      /* too old to decide, treat it as a duplicate */
+      return 0;
+    }
+
+    /* originator restarted its sequence numbers */
+    entry->current = seqno;
+    entry->processed = 0;
+    entry->forwarded = 0;
+    diff = 0;
+  }
+  entry->too_old_count = 0;
+
+  bit = 1u << (-diff);
+  new_flags = 0;
+
+  if ((flags & OLSRV2_DUPLICATE_PROCESS) != 0
+      && (entry->processed & bit) == 0) {
+    entry->processed |= bit;
+    new_flags |= OLSRV2_DUPLICATE_PROCESS;
+  }
+  if ((flags & OLSRV2_DUPLICATE_FORWARD) != 0
+      && (entry->forwarded & bit) == 0) {
+    entry->forwarded |= bit;
+    new_flags |= OLSRV2_DUPLICATE_FORWARD;
+  }
+
+  /* keep the entry as long as the longest validity */
+  if (!oonf_timer_is_active(&entry->_vtime)
+      || oonf_timer_get_due(&entry->_vtime) < vtime) {
+    oonf_timer_set(&entry->_vtime, vtime);
+  }
+  return new_flags;
+}
+
+/**
+ * Check which checks have already been recorded for a message without
+ * changing the duplicate set.
+ * @param msg_type message type
+ * @param originator originator address of message
+ * @param seqno message sequence number
+ * @return bitmask of olsrv2_duplicate_flags recorded for this message
+ */
+int
+olsrv2_duplicate_test(uint8_t msg_type,
+    const struct netaddr *originator, uint16_t seqno) {
+  struct olsrv2_duplicate_key key;
+  struct olsrv2_duplicate_entry *entry;
+  uint32_t bit;
+  int diff, flags;
+
+  entry = _get_entry(&key, msg_type, originator);
+  if (entry == NULL) {
+    return 0;
+  }
+
+  diff = (int16_t)(seqno - entry->current);
+  if (diff > 0 || -diff >= OLSRV2_DUPLICATE_WINDOW) {
+    /* new or too old, let olsrv2_duplicate_add() decide */
+    return 0;
+  }
+
+  bit = 1u << (-diff);
+  flags = 0;
+  if (entry->processed & bit) {
+    flags |= OLSRV2_DUPLICATE_PROCESS;
+  }
+  if (entry->forwarded & bit) {
+    flags |= OLSRV2_DUPLICATE_FORWARD;
+  }
+  return flags;
+}
+
+/**
+ * Initialize a duplicate set key and look up its entry
+ * @param key pointer to key buffer
+ * @param msg_type message type
+ * @param originator originator address of message
+ * @return duplicate set entry, NULL if not found
+ */
+static struct olsrv2_duplicate_entry *
+_get_entry(struct olsrv2_duplicate_key *key,
+    uint8_t msg_type, const struct netaddr *originator) {
+  struct olsrv2_duplicate_entry *entry;
+
+  memset(key, 0, sizeof(*key));
+  memcpy(&key->originator, originator, sizeof(key->originator));
+  key->msg_type = msg_type;
+
+  return avl_find_element(&_duplicate_tree, key, entry, _node);
+}
+
+/**
+ * Callback to remove a duplicate set entry
+ * @param ptr duplicate set entry
+ */
+static void
+_cb_vtime(void *ptr) {
+  struct olsrv2_duplicate_entry *entry = ptr;
+
+  oonf_timer_stop(&entry->_vtime);
+  avl_remove(&_duplicate_tree, &entry->_node);
+  oonf_class_free(&_duplicate_class, entry);
+}
+
+/**
+ * AVL comparator for duplicate set keys
+ * @param k1 pointer to first key
+ * @param k2 pointer to second key
+ * @return <0, 0 or >0 like memcmp
+ */
+static int
+_avl_comp_duplicate(const void *k1, const void *k2) {
+  return memcmp(k1, k2, sizeof(struct olsrv2_duplicate_key));
+}
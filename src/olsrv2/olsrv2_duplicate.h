@@ -0,0 +1,138 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+#ifndef OLSRV2_DUPLICATE_H_
+#define OLSRV2_DUPLICATE_H_
+
+#include "common/avl.h"
+#include "common/common_types.h"
+#include "common/netaddr.h"
+#include "subsystems/oonf_timer.h"
+
+/* number of sequence numbers remembered below the newest one */
+#define OLSRV2_DUPLICATE_WINDOW 32
+
+/*
+ * number of consecutive too old sequence numbers before an originator
+ * is considered to have restarted its sequence numbers
+ */
+#define OLSRV2_DUPLICATE_MAX_TOO_OLD 16
+
+/* checks of a message that are recorded in the duplicate set */
+enum olsrv2_duplicate_flags {
+  OLSRV2_DUPLICATE_PROCESS = 1<<0,
+  OLSRV2_DUPLICATE_FORWARD = 1<<1,
+};
+
+/* key of the duplicate set */
+struct olsrv2_duplicate_key {
+  struct netaddr originator;
+  uint8_t msg_type;
+};
+
+/*
+ * combined processing and forwarding history of the messages
+ * of one originator and message type
+ */
+struct olsrv2_duplicate_entry {
+  struct olsrv2_duplicate_key key;
+
+  /* newest sequence number */
+  uint16_t current;
+
+  /* bit n is set if sequence number current-n was processed/forwarded */
+  uint32_t processed;
+  uint32_t forwarded;
+
+  /* number of consecutive sequence numbers outside of the window */
+  uint8_t too_old_count;
+
+  /* validity time of the entry */
+  struct oonf_timer_entry _vtime;
+
+  /* member of global duplicate set tree */
+  struct avl_node _node;
+};
+
+void olsrv2_duplicate_init(void);
+void olsrv2_duplicate_cleanup(void);
+
+EXPORT int olsrv2_duplicate_add(uint8_t msg_type,
+    const struct netaddr *originator, uint16_t seqno,
+    int flags, uint64_t vtime);
+EXPORT int olsrv2_duplicate_test(uint8_t msg_type,
+    const struct netaddr *originator, uint16_t seqno);
+
+/**
+ * @param from_selector true if the message was received from a
+ *   flooding MPR selector
+ * @return bitmask of olsrv2_duplicate_flags to record for a message
+ */
+static INLINE int
+olsrv2_duplicate_get_flags(bool from_selector) {
+  /*
+   * only copies from a flooding MPR selector are recorded as
+   * forwarded, otherwise a later copy from a selector would not
+   * be forwarded anymore (RFC 7181, section 12)
+   */
+  if (from_selector) {
+    return OLSRV2_DUPLICATE_PROCESS | OLSRV2_DUPLICATE_FORWARD;
+  }
+  return OLSRV2_DUPLICATE_PROCESS;
+}
+
+/**
+ * @param recorded bitmask of olsrv2_duplicate_flags already recorded
+ *   for a message
+ * @param from_selector true if this copy of the message was received
+ *   from a flooding MPR selector
+ * @return true if this copy has neither to be processed nor forwarded
+ */
+static INLINE bool
+olsrv2_duplicate_is_known(int recorded, bool from_selector) {
+  if ((recorded & OLSRV2_DUPLICATE_PROCESS) == 0) {
+    return false;
+  }
+  return (recorded & OLSRV2_DUPLICATE_FORWARD) != 0 || !from_selector;
+}
+
+#endif /* OLSRV2_DUPLICATE_H_ */
@@ -46,10 +46,10 @@
 #include "rfc5444/rfc5444_reader.h"
 #include "core/oonf_logging.h"
 #include "core/oonf_subsystem.h"
-#include "subsystems/oonf_duplicate_set.h"
 #include "subsystems/oonf_rfc5444.h"
 
 #include "olsrv2/olsrv2.h"
+#include "olsrv2/olsrv2_duplicate.h"
 #include "olsrv2/olsrv2_originator.h"
 #include "olsrv2/olsrv2_reader.h"
 #include "olsrv2/olsrv2_routing.h"
@@ -79,6 +79,9 @@ struct _olsrv2_data {
 };
 
 /* Prototypes */
+static enum rfc5444_result
+_cb_duplicate_filter(struct rfc5444_reader_tlvblock_context *context);
+
 static enum rfc5444_result
 _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context);
 
@@ -88,6 +91,13 @@ static enum rfc5444_result _cb_messagetlvs_end(
     struct rfc5444_reader_tlvblock_context *context, bool dropped);
 
 /* definition of the RFC5444 reader components */
+static struct rfc5444_reader_tlvblock_consumer _olsrv2_duplicate_filter = {
+  /* run in front of all validators and parsers of TCs */
+  .order = RFC5444_VALIDATOR_PRIORITY - 1,
+  .msg_id = RFC5444_MSGTYPE_TC,
+  .start_callback = _cb_duplicate_filter,
+};
+
 static struct rfc5444_reader_tlvblock_consumer _olsrv2_message_consumer = {
   .order = RFC5444_MAIN_PARSER_PRIORITY,
   .msg_id = RFC5444_MSGTYPE_TC,
@@ -132,6 +142,8 @@ void
 olsrv2_reader_init(struct oonf_rfc5444_protocol *p) {
   _protocol = p;
 
+  rfc5444_reader_add_message_consumer(
+      &_protocol->reader, &_olsrv2_duplicate_filter, NULL, 0);
   rfc5444_reader_add_message_consumer(
       &_protocol->reader, &_olsrv2_message_consumer,
       _olsrv2_message_tlvs, ARRAYSIZE(_olsrv2_message_tlvs));
@@ -149,6 +161,41 @@ olsrv2_reader_cleanup(void) {
       &_protocol->reader, &_olsrv2_address_consumer);
   rfc5444_reader_remove_message_consumer(
       &_protocol->reader, &_olsrv2_message_consumer);
+  rfc5444_reader_remove_message_consumer(
+      &_protocol->reader, &_olsrv2_duplicate_filter);
+}
+
+/**
+ * Callback that drops known duplicate TCs based only on the message
+ * header. This keeps them away from all other TC consumers.
+ * A processed TC still passes the filter if it was not forwarded yet
+ * and this copy comes from a flooding MPR selector, the processing
+ * and forwarding decision is done in _cb_messagetlvs().
+ * @param context
+ * @return
+ */
+static enum rfc5444_result
+_cb_duplicate_filter(struct rfc5444_reader_tlvblock_context *context) {
+  int flags;
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
+
+  if (!context->has_origaddr || !context->has_seqno) {
+    /* let the TC parser handle broken messages */
+    return RFC5444_OKAY;
+  }
+
+  flags = olsrv2_duplicate_test(
+      context->msg_type, &context->orig_addr, context->seqno);
+  if (flags == 0 || !olsrv2_duplicate_is_known(
+      flags, olsrv2_mpr_is_forwarding_selector(context))) {
+    return RFC5444_OKAY;
+  }
+
+  OONF_DEBUG(LOG_OLSRV2_R, "Drop duplicate TC from %s (seqno %u)",
+      netaddr_to_string(&buf, &context->orig_addr), context->seqno);
+  return RFC5444_DROP_MESSAGE;
 }
 
 /**
@@ -161,6 +208,7 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
   uint64_t itime;
   uint16_t ansn;
   uint8_t tmp;
+  bool process, forward;
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
 #endif
@@ -218,14 +266,14 @@ _cb_messagetlvs(struct rfc5444_reader_tlvblock_context *context) {
     itime = 0;
   }
 
-  /* test if we already forwarded the message */
-  if (!olsrv2_mpr_shall_forwarding(context, _current.vtime)) {
+  /* test if we already forwarded and processed the message */
+  olsrv2_mpr_check_message(context, _current.vtime, &process, &forward);
+  if (!forward) {
     /* mark message as 'no forward */
     rfc5444_reader_prevent_forwarding(context);
   }
 
-  /* test if we already processed the message */
-  if (!olsrv2_mpr_shall_process(context, _current.vtime)) {
+  if (!process) {
     OONF_DEBUG(LOG_OLSRV2_R, "Processing set says 'do not process'");
     return RFC5444_DROP_MESSAGE;
   }
@@ -267,8 +315,11 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
   struct nhdp_domain *domain;
   struct olsrv2_tc_edge *edge;
   struct olsrv2_tc_attachment *end;
+  struct olsrv2_tc_edge_domaindata *edge_data;
+  struct olsrv2_tc_attachment_domaindata *end_data;
   uint32_t cost_in[NHDP_MAXIMUM_DOMAINS];
   uint32_t cost_out[NHDP_MAXIMUM_DOMAINS];
+  uint32_t cost;
   uint16_t metric_value;
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
@@ -325,10 +376,15 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
             _current.node->ansn,
             cost_out[domain->index], cost_in[domain->index]);
         edge->ansn = _current.node->ansn;
-        edge->cost[domain->index] = cost_out[domain->index];
+        edge_data = olsrv2_tc_edge_get_domaindata(domain, edge);
+        if (edge_data->cost != cost_out[domain->index]) {
+          edge_data->cost = cost_out[domain->index];
+          olsrv2_tc_edge_changed(edge);
+        }
 
         if (edge->inverse->virtual) {
-          edge->inverse->cost[domain->index] = cost_in[domain->index];
+          olsrv2_tc_edge_get_domaindata(domain, edge->inverse)->cost =
+              cost_in[domain->index];
         }
       }
     }
@@ -342,7 +398,11 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
             _current.node->ansn,
             cost_out[domain->index]);
         end->ansn = _current.node->ansn;
-        end->cost[domain->index] = cost_out[domain->index];
+        end_data = olsrv2_tc_attachment_get_domaindata(domain, end);
+        if (end_data->cost != cost_out[domain->index]) {
+          end_data->cost = cost_out[domain->index];
+          olsrv2_tc_endpoint_changed(end);
+        }
       }
     }
   }
@@ -365,12 +425,18 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
           tlv->single_value[0]);
       end->ansn = _current.node->ansn;
       if (cost_out[domain->index] == RFC5444_METRIC_INFINITE) {
-        end->cost[domain->index] = 0;
+        cost = 0;
       }
       else {
-        end->cost[domain->index] = cost_out[domain->index];
+        cost = cost_out[domain->index];
+      }
+      end_data = olsrv2_tc_attachment_get_domaindata(domain, end);
+      if (end_data->cost != cost
+          || end_data->distance != tlv->single_value[0]) {
+        end_data->cost = cost;
+        end_data->distance = tlv->single_value[0];
+        olsrv2_tc_endpoint_changed(end);
       }
-      end->distance[domain->index] = tlv->single_value[0];
     }
   }
   return RFC5444_OKAY;
@@ -385,24 +451,27 @@ _cb_addresstlvs(struct rfc5444_reader_tlvblock_context *context __attribute__((u
 static enum rfc5444_result
 _cb_messagetlvs_end(struct rfc5444_reader_tlvblock_context *context __attribute__((unused)),
     bool dropped) {
-  /* cleanup everything that is not the current ANSN */
-  struct olsrv2_tc_edge *edge, *edge_it;
-  struct olsrv2_tc_attachment *end, *end_it;
+  uint64_t hold_time;
 
   if (dropped || _current.node == NULL) {
     return RFC5444_OKAY;
   }
 
-  avl_for_each_element_safe(&_current.node->_edges, edge, _node, edge_it) {
-    if (edge->ansn != _current.node->ansn) {
-      olsrv2_tc_edge_remove(edge);
-    }
+  if (_current.complete_tc) {
+    /* cleanup everything that is not the current ANSN */
+    olsrv2_tc_node_sweep(_current.node);
   }
-
-  avl_for_each_element_safe(&_current.node->_endpoints, end, _src_node, end_it) {
-    if (end->ansn != _current.node->ansn) {
-      olsrv2_tc_endpoint_remove(end);
+  else {
+    /*
+     * only a fragment of the answer set, keep the old data until
+     * the rest of the fragments (or their next retransmission)
+     * had time to arrive
+     */
+    hold_time = _current.node->interval_time;
+    if (hold_time == 0 || hold_time > _current.vtime) {
+      hold_time = _current.vtime;
     }
+    olsrv2_tc_node_delay_sweep(_current.node, hold_time);
   }
 
   _current.node = NULL;
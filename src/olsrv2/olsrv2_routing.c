@@ -508,6 +508,8 @@ _handle_working_queue(struct nhdp_domain *domain) {
   struct olsrv2_tc_node *tc_node;
   struct olsrv2_tc_edge *tc_edge;
   struct olsrv2_tc_attachment *tc_attached;
+  struct olsrv2_tc_edge_domaindata *edge_data;
+  struct olsrv2_tc_attachment_domaindata *attached_data;
 
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
@@ -543,21 +545,23 @@ _handle_working_queue(struct nhdp_domain *domain) {
 
     /* iterate over edges */
     avl_for_each_element(&tc_node->_edges, tc_edge, _node) {
-      if (tc_edge->cost[domain->index] < RFC5444_METRIC_INFINITE) {
+      edge_data = olsrv2_tc_edge_get_domaindata(domain, tc_edge);
+      if (edge_data->cost < RFC5444_METRIC_INFINITE) {
         /* add new tc_node to working tree */
         _insert_into_working_tree(&tc_edge->dst->target, first_hop,
-            tc_edge->cost[domain->index], target->_dijkstra.path_cost,
+            edge_data->cost, target->_dijkstra.path_cost,
             0, false);
       }
     }
 
     /* iterate over attached networks and addresses */
     avl_for_each_element(&tc_node->_endpoints, tc_attached, _src_node) {
-      if (tc_attached->cost[domain->index] < RFC5444_METRIC_INFINITE) {
+      attached_data = olsrv2_tc_attachment_get_domaindata(domain, tc_attached);
+      if (attached_data->cost < RFC5444_METRIC_INFINITE) {
         /* add attached network or address to working tree */
         _insert_into_working_tree(&tc_attached->dst->target, first_hop,
-            tc_attached->cost[domain->index], target->_dijkstra.path_cost,
-            tc_attached->distance[domain->index], false);
+            attached_data->cost, target->_dijkstra.path_cost,
+            attached_data->distance, false);
       }
     }
   }
@@ -576,10 +580,9 @@ _handle_nhdp_routes(struct nhdp_domain *domain) {
   struct nhdp_neighbor_domaindata *neigh_data;
   struct nhdp_neighbor *neigh;
   struct nhdp_naddr *naddr;
-  struct nhdp_l2hop *l2hop;
-  struct nhdp_link *lnk;
+  struct nhdp_2hop_domaindata *twohop_data;
+  struct nhdp_2hop *twohop;
   uint32_t neighcost;
-  uint32_t l2hop_pathcost;
 
   list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
 
@@ -610,32 +613,30 @@ _handle_nhdp_routes(struct nhdp_domain *domain) {
       /* the direct link is better than the dijkstra calculation */
       _update_routing_entry(rtentry, domain, neigh, 0, neighcost, true);
     }
+  }
 
-    list_for_each_element(&neigh->_links, lnk, _neigh_node) {
-      avl_for_each_element(&lnk->_2hop, l2hop, _link_node) {
-        /* get new pathcost to 2hop neighbor */
-        l2hop_pathcost = nhdp_domain_get_l2hopdata(domain, l2hop)->metric.out;
-        if (l2hop_pathcost >= RFC5444_METRIC_INFINITE) {
-          continue;
-        }
-
-        if (!netaddr_acl_check_accept(olsrv2_get_routable(), &l2hop->twohop_addr)) {
-          /* not a routable address, check the next one */
-          continue;
-        }
-
-        l2hop_pathcost += neighcost;
-
-        rtentry = _add_entry(domain, &l2hop->twohop_addr);
-        if (rtentry == NULL || (rtentry->set && rtentry->cost <= l2hop_pathcost)) {
-          /* next 2hop address */
-          continue;
-        }
-
-        /* the 2-hop route is better than the dijkstra calculation */
-        _update_routing_entry(rtentry, domain, neigh, 0, l2hop_pathcost, false);
-      }
+  /* the best path to each 2hop address is kept by the NHDP database */
+  avl_for_each_element(&nhdp_2hop_tree, twohop, _global_node) {
+    twohop_data = nhdp_domain_get_2hopdata(domain, twohop);
+    if (twohop_data->best_neigh == NULL) {
+      continue;
+    }
+
+    if (!netaddr_acl_check_accept(olsrv2_get_routable(), &twohop->twohop_addr)) {
+      /* not a routable address, check the next one */
+      continue;
     }
+
+    rtentry = _add_entry(domain, &twohop->twohop_addr);
+    if (rtentry == NULL
+        || (rtentry->set && rtentry->cost <= twohop_data->metric.out)) {
+      /* next 2hop address */
+      continue;
+    }
+
+    /* the 2-hop route is better than the dijkstra calculation */
+    _update_routing_entry(rtentry, domain, twohop_data->best_neigh, 0,
+        twohop_data->metric.out, false);
   }
 }
 
@@ -44,50 +44,84 @@
 #include "common/common_types.h"
 #include "common/netaddr.h"
 #include "rfc5444/rfc5444.h"
+#include "core/oonf_logging.h"
 #include "subsystems/oonf_class.h"
+#include "subsystems/oonf_clock.h"
 #include "subsystems/oonf_timer.h"
 
+#include "nhdp/nhdp_db.h"
 #include "nhdp/nhdp_domain.h"
-#include "nhdp/nhdp.h"
 
+#include "olsrv2/olsrv2.h"
 #include "olsrv2/olsrv2_routing.h"
 #include "olsrv2/olsrv2_tc.h"
 
 /* prototypes */
 static void _cb_tc_node_timeout(void *);
+static void _cb_tc_node_sweep(void *);
 static bool _remove_edge(struct olsrv2_tc_edge *edge, bool cleanup);
+static bool _make_room(const struct netaddr *originator, bool virtual);
+static void _remove_virtual_node(struct olsrv2_tc_node *node);
+static bool _is_preferred(const struct netaddr *originator);
+static void _set_expiry(struct olsrv2_tc_node *node, uint64_t vtime);
+static int _avl_comp_expiry(const void *, const void *);
 
 /* classes for topology data */
 static struct oonf_class _tc_node_class = {
-  .name = "olsrv2 tc node",
+  .name = OLSRV2_CLASS_TC_NODE,
   .size = sizeof(struct olsrv2_tc_node),
 };
 
 static struct oonf_class _tc_edge_class = {
-  .name = "olsrv2 tc edge",
+  .name = OLSRV2_CLASS_TC_EDGE,
   .size = sizeof(struct olsrv2_tc_edge),
 };
 
 static struct oonf_class _tc_attached_class = {
-  .name = "olsrv2 tc attached network",
+  .name = OLSRV2_CLASS_ATTACHED,
   .size = sizeof(struct olsrv2_tc_attachment),
 };
 
 static struct oonf_class _tc_endpoint_class = {
-  .name = "olsrv2 tc attached network endpoint",
+  .name = OLSRV2_CLASS_ENDPOINT,
   .size = sizeof(struct olsrv2_tc_endpoint),
 };
 
+/* per-domain data of edges and attached networks */
+struct nhdp_domain_classdata olsrv2_tc_edge_classdata = {
+  .class_name = OLSRV2_CLASS_TC_EDGE,
+  .size = sizeof(struct olsrv2_tc_edge_domaindata),
+};
+
+struct nhdp_domain_classdata olsrv2_tc_attachment_classdata = {
+  .class_name = OLSRV2_CLASS_ATTACHED,
+  .size = sizeof(struct olsrv2_tc_attachment_domaindata),
+};
+
 /* validity timer for tc nodes */
 static struct oonf_timer_info _validity_info = {
   .name = "olsrv2 tc node validity",
   .callback = _cb_tc_node_timeout,
 };
 
+/* timer to collect all fragments of an incomplete TC */
+static struct oonf_timer_info _sweep_info = {
+  .name = "olsrv2 tc node sweep",
+  .callback = _cb_tc_node_sweep,
+};
+
 /* global trees for tc nodes and endpoints */
 struct avl_tree olsrv2_tc_tree;
 struct avl_tree olsrv2_tc_endpoint_tree;
 
+/* tc nodes ordered by expiry, virtual nodes first */
+static struct avl_tree _expiry_tree;
+
+/* size limits of the database, 0 means no limit */
+static uint32_t _max_nodes = 0;
+static uint32_t _max_edges = 0;
+static uint32_t _max_endpoints = 0;
+
 /**
  * Initialize tc database
  */
@@ -98,8 +132,16 @@ olsrv2_tc_init(void) {
   oonf_class_add(&_tc_attached_class);
   oonf_class_add(&_tc_endpoint_class);
 
+  /* domains are configured later, so this cannot fail */
+  nhdp_domain_classdata_add(&olsrv2_tc_edge_classdata);
+  nhdp_domain_classdata_add(&olsrv2_tc_attachment_classdata);
+
+  oonf_timer_add(&_validity_info);
+  oonf_timer_add(&_sweep_info);
+
   avl_init(&olsrv2_tc_tree, avl_comp_netaddr, false);
   avl_init(&olsrv2_tc_endpoint_tree, avl_comp_netaddr, true);
+  avl_init(&_expiry_tree, _avl_comp_expiry, true);
 }
 
 /**
@@ -126,12 +168,34 @@ olsrv2_tc_cleanup(void) {
     olsrv2_tc_node_remove(node);
   }
 
+  oonf_timer_remove(&_sweep_info);
+  oonf_timer_remove(&_validity_info);
+
+  nhdp_domain_classdata_remove(&olsrv2_tc_attachment_classdata);
+  nhdp_domain_classdata_remove(&olsrv2_tc_edge_classdata);
+
   oonf_class_remove(&_tc_endpoint_class);
   oonf_class_remove(&_tc_attached_class);
   oonf_class_remove(&_tc_edge_class);
   oonf_class_remove(&_tc_node_class);
 }
 
+/**
+ * Set the size limits of the topology database. Existing entries
+ * are not removed if the database is larger than the new limits.
+ * @param max_nodes maximum number of tc nodes, 0 for no limit
+ * @param max_edges maximum number of edges and attachments
+ *   of a single tc node, 0 for no limit
+ * @param max_endpoints maximum number of endpoints, 0 for no limit
+ */
+void
+olsrv2_tc_set_limits(uint32_t max_nodes,
+    uint32_t max_edges, uint32_t max_endpoints) {
+  _max_nodes = max_nodes;
+  _max_edges = max_edges;
+  _max_endpoints = max_endpoints;
+}
+
 /**
  * Add a new tc node to the database
  * @param originator originator address of node
@@ -147,6 +211,11 @@ olsrv2_tc_node_add(struct netaddr *originator,
   node = avl_find_element(
       &olsrv2_tc_tree, originator, node, _originator_node);
   if (!node) {
+    if (_max_nodes > 0 && olsrv2_tc_tree.count >= _max_nodes
+        && !_make_room(originator, vtime == 0)) {
+      return NULL;
+    }
+
     node = oonf_class_malloc(&_tc_node_class);
     if (node == NULL) {
       return NULL;
@@ -163,14 +232,20 @@ olsrv2_tc_node_add(struct netaddr *originator,
     node->_validity_time.info = &_validity_info;
     node->_validity_time.cb_context = node;
 
+    node->_sweep_time.info = &_sweep_info;
+    node->_sweep_time.cb_context = node;
+
     node->ansn = ansn;
 
     /* initialize dijkstra data */
     olsrv2_routing_dijkstra_node_init(&node->target._dijkstra);
 
-    /* hook into global tree */
+    /* hook into global trees */
     avl_insert(&olsrv2_tc_tree, &node->_originator_node);
 
+    node->_expiry_node.key = &node->_expiry;
+    avl_insert(&_expiry_tree, &node->_expiry_node);
+
     /* fire event */
     oonf_class_event(&_tc_node_class, node, OONF_OBJECT_ADDED);
   }
@@ -182,6 +257,7 @@ olsrv2_tc_node_add(struct netaddr *originator,
     oonf_class_event(&_tc_node_class, node, OONF_OBJECT_ADDED);
   }
   oonf_timer_set(&node->_validity_time, vtime);
+  _set_expiry(node, vtime);
   return node;
 }
 
@@ -208,14 +284,66 @@ olsrv2_tc_node_remove(struct olsrv2_tc_node *node) {
     olsrv2_tc_endpoint_remove(net);
   }
 
-  /* stop validity timer */
+  /* stop validity and sweep timer */
   oonf_timer_stop(&node->_validity_time);
+  oonf_timer_stop(&node->_sweep_time);
 
   /* remove from global tree and free memory if node is not needed anymore*/
   if (node->_edges.count == 0) {
     avl_remove(&olsrv2_tc_tree, &node->_originator_node);
+    avl_remove(&_expiry_tree, &node->_expiry_node);
     oonf_class_free(&_tc_node_class, node);
   }
+  else {
+    /* node stays as a virtual node */
+    _set_expiry(node, 0);
+  }
+}
+
+/**
+ * Remove all edges and attached networks of a tc node
+ * which were not refreshed by its current ANSN.
+ * @param node pointer to node
+ */
+void
+olsrv2_tc_node_sweep(struct olsrv2_tc_node *node) {
+  struct olsrv2_tc_edge *edge, *edge_it;
+  struct olsrv2_tc_attachment *end, *end_it;
+
+  oonf_timer_stop(&node->_sweep_time);
+
+  avl_for_each_element_safe(&node->_edges, edge, _node, edge_it) {
+    if (edge->ansn != node->ansn) {
+      olsrv2_tc_edge_remove(edge);
+    }
+  }
+
+  avl_for_each_element_safe(&node->_endpoints, end, _src_node, end_it) {
+    if (end->ansn != node->ansn) {
+      olsrv2_tc_endpoint_remove(end);
+    }
+  }
+}
+
+/**
+ * Schedule the removal of outdated topology data of a tc node
+ * after an incomplete TC. The timer is only started once per ANSN,
+ * so further fragments of the same answer set cannot delay the
+ * cleanup indefinitely.
+ * @param node pointer to node
+ * @param hold_time time to collect the other fragments
+ *   of the current ANSN
+ */
+void
+olsrv2_tc_node_delay_sweep(struct olsrv2_tc_node *node, uint64_t hold_time) {
+  if (oonf_timer_is_active(&node->_sweep_time)
+      && node->_sweep_ansn == node->ansn) {
+    /* timer already running for this answer set */
+    return;
+  }
+
+  node->_sweep_ansn = node->ansn;
+  oonf_timer_set(&node->_sweep_time, hold_time);
 }
 
 /**
@@ -228,17 +356,38 @@ struct olsrv2_tc_edge *
 olsrv2_tc_edge_add(struct olsrv2_tc_node *src, struct netaddr *addr) {
   struct olsrv2_tc_edge *edge = NULL, *inverse = NULL;
   struct olsrv2_tc_node *dst = NULL;
-  int i;
+  struct nhdp_domain *domain;
+#ifdef OONF_LOG_INFO
+  struct netaddr_str nbuf1, nbuf2;
+#endif
 
   edge = avl_find_element(&src->_edges, addr, edge, _node);
   if (edge != NULL) {
-    edge->virtual = false;
-
-    /* fire event */
-    oonf_class_event(&_tc_edge_class, edge, OONF_OBJECT_ADDED);
+    if (edge->virtual) {
+      if (_max_edges > 0 && src->_advertised_count >= _max_edges) {
+        OONF_INFO(LOG_OLSRV2, "Node %s has too many edges,"
+            " dropped edge to %s",
+            netaddr_to_string(&nbuf1, &src->target.addr),
+            netaddr_to_string(&nbuf2, addr));
+        return NULL;
+      }
+
+      edge->virtual = false;
+      src->_advertised_count++;
+
+      /* fire event */
+      oonf_class_event(&_tc_edge_class, edge, OONF_OBJECT_ADDED);
+    }
     return edge;
   }
 
+  if (_max_edges > 0 && src->_advertised_count >= _max_edges) {
+    OONF_INFO(LOG_OLSRV2, "Node %s has too many edges, dropped edge to %s",
+        netaddr_to_string(&nbuf1, &src->target.addr),
+        netaddr_to_string(&nbuf2, addr));
+    return NULL;
+  }
+
   /* allocate edge */
   edge = oonf_class_malloc(&_tc_edge_class);
   if (edge == NULL) {
@@ -268,21 +417,24 @@ olsrv2_tc_edge_add(struct olsrv2_tc_node *src, struct netaddr *addr) {
   edge->src = src;
   edge->dst = dst;
   edge->inverse = inverse;
-  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
-    edge->cost[i] = RFC5444_METRIC_INFINITE;
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    olsrv2_tc_edge_get_domaindata(domain, edge)->cost =
+        RFC5444_METRIC_INFINITE;
   }
 
   /* hook edge into src node */
   edge->_node.key = &dst->target.addr;
   avl_insert(&src->_edges, &edge->_node);
+  src->_advertised_count++;
 
   /* initialize inverse (virtual) edge */
   inverse->src = dst;
   inverse->dst = src;
   inverse->inverse = edge;
   inverse->virtual = true;
-  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
-    inverse->cost[i] = RFC5444_METRIC_INFINITE;
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    olsrv2_tc_edge_get_domaindata(domain, inverse)->cost =
+        RFC5444_METRIC_INFINITE;
   }
 
   /* hook inverse edge into dst node */
@@ -304,6 +456,15 @@ olsrv2_tc_edge_remove(struct olsrv2_tc_edge *edge) {
   return _remove_edge(edge, true);
 }
 
+/**
+ * Announce that the costs of a tc edge have changed
+ * @param edge pointer to tc edge
+ */
+void
+olsrv2_tc_edge_changed(struct olsrv2_tc_edge *edge) {
+  oonf_class_event(&_tc_edge_class, edge, OONF_OBJECT_CHANGED);
+}
+
 /**
  * Add an endpoint to a tc node
  * @param node pointer to tc node
@@ -317,19 +478,35 @@ olsrv2_tc_endpoint_add(struct olsrv2_tc_node *node,
     struct netaddr *prefix, bool mesh) {
   struct olsrv2_tc_attachment *net;
   struct olsrv2_tc_endpoint *end;
-  int i;
+  struct nhdp_domain *domain;
+#ifdef OONF_LOG_INFO
+  struct netaddr_str nbuf1, nbuf2;
+#endif
 
   net = avl_find_element(&node->_endpoints, prefix, net, _src_node);
   if (net != NULL) {
     return net;
   }
 
+  if (_max_edges > 0 && node->_advertised_count >= _max_edges) {
+    OONF_INFO(LOG_OLSRV2, "Node %s has too many endpoints, dropped %s",
+        netaddr_to_string(&nbuf1, &node->target.addr),
+        netaddr_to_string(&nbuf2, prefix));
+    return NULL;
+  }
+  end = avl_find_element(&olsrv2_tc_endpoint_tree, prefix, end, _node);
+  if (end == NULL && _max_endpoints > 0
+      && olsrv2_tc_endpoint_tree.count >= _max_endpoints) {
+    OONF_INFO(LOG_OLSRV2, "Topology database full, dropped endpoint %s",
+        netaddr_to_string(&nbuf2, prefix));
+    return NULL;
+  }
+
   net = oonf_class_malloc(&_tc_attached_class);
   if (net == NULL) {
     return NULL;
   }
 
-  end = avl_find_element(&olsrv2_tc_endpoint_tree, prefix, end, _node);
   if (end == NULL) {
     /* create new endpoint */
     end = oonf_class_malloc(&_tc_endpoint_class);
@@ -353,13 +530,15 @@ olsrv2_tc_endpoint_add(struct olsrv2_tc_node *node,
   /* initialize attached network */
   net->src = node;
   net->dst = end;
-  for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
-    net->cost[i] = RFC5444_METRIC_INFINITE;
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    olsrv2_tc_attachment_get_domaindata(domain, net)->cost =
+        RFC5444_METRIC_INFINITE;
   }
 
   /* hook into src node */
-  net->_src_node.key = &end->target;
+  net->_src_node.key = &end->target.addr;
   avl_insert(&node->_endpoints, &net->_src_node);
+  node->_advertised_count++;
 
   /* hook into endpoint */
   net->_endpoint_node.key = &node->target.addr;
@@ -383,6 +562,7 @@ olsrv2_tc_endpoint_remove(
 
   /* remove from node */
   avl_remove(&net->src->_endpoints, &net->_src_node);
+  net->src->_advertised_count--;
 
   /* remove from endpoint */
   avl_remove(&net->dst->_attached_networks, &net->_endpoint_node);
@@ -399,6 +579,15 @@ olsrv2_tc_endpoint_remove(
   oonf_class_free(&_tc_attached_class, net);
 }
 
+/**
+ * Announce that the costs of a tc attachment have changed
+ * @param net pointer to tc attachment
+ */
+void
+olsrv2_tc_endpoint_changed(struct olsrv2_tc_attachment *net) {
+  oonf_class_event(&_tc_attached_class, net, OONF_OBJECT_CHANGED);
+}
+
 /**
  * Callback triggered when a tc node times out
  * @param ptr pointer to tc node
@@ -411,6 +600,19 @@ _cb_tc_node_timeout(void *ptr) {
   olsrv2_routing_trigger_update();
 }
 
+/**
+ * Callback triggered when the fragments of an incomplete TC
+ * had enough time to arrive
+ * @param ptr pointer to tc node
+ */
+static void
+_cb_tc_node_sweep(void *ptr) {
+  struct olsrv2_tc_node *node = ptr;
+
+  olsrv2_tc_node_sweep(node);
+  olsrv2_routing_trigger_update();
+}
+
 /**
  * Remove a tc edge from the database
  * @param edge pointer to tc edge
@@ -429,6 +631,7 @@ _remove_edge(struct olsrv2_tc_edge *edge, bool cleanup) {
 
   /* fire event */
   oonf_class_event(&_tc_edge_class, edge, OONF_OBJECT_REMOVED);
+  edge->src->_advertised_count--;
 
   if (!edge->inverse->virtual) {
     /* make this edge virtual */
@@ -457,3 +660,142 @@ _remove_edge(struct olsrv2_tc_edge *edge, bool cleanup) {
 
   return removed_node;
 }
+
+/**
+ * Try to remove a node from the full topology database to make room
+ * for a new one. Virtual nodes are removed first. Nodes that are not
+ * reachable through a symmetric neighbor are only removed to make
+ * room for a node that is.
+ * @param originator originator address of the new node
+ * @param virtual true if the new node would be virtual
+ * @return true if a node was removed, false otherwise
+ */
+static bool
+_make_room(const struct netaddr *originator, bool virtual) {
+  struct olsrv2_tc_node *node, *victim;
+  struct netaddr addr;
+#ifdef OONF_LOG_INFO
+  struct netaddr_str nbuf;
+#endif
+
+  if (virtual) {
+    /* virtual nodes never push out other nodes */
+    OONF_INFO(LOG_OLSRV2, "Topology database full, dropped virtual node %s",
+        netaddr_to_string(&nbuf, originator));
+    return false;
+  }
+
+  /* virtual nodes have an expiry of zero, so they come first */
+  victim = avl_first_element(&_expiry_tree, victim, _expiry_node);
+  if (victim->_expiry == 0) {
+    OONF_INFO(LOG_OLSRV2, "Topology database full, evicting virtual node %s",
+        netaddr_to_string(&nbuf, &victim->target.addr));
+    _remove_virtual_node(victim);
+    return true;
+  }
+
+  if (!_is_preferred(originator)) {
+    OONF_INFO(LOG_OLSRV2, "Topology database full, dropped node %s",
+        netaddr_to_string(&nbuf, originator));
+    return false;
+  }
+
+  /* remove the unpreferred node which would time out first */
+  victim = NULL;
+  avl_for_each_element(&_expiry_tree, node, _expiry_node) {
+    if (!_is_preferred(&node->target.addr)) {
+      victim = node;
+      break;
+    }
+  }
+
+  if (victim == NULL) {
+    OONF_INFO(LOG_OLSRV2, "Topology database full, dropped node %s",
+        netaddr_to_string(&nbuf, originator));
+    return false;
+  }
+
+  OONF_INFO(LOG_OLSRV2, "Topology database full, evicting node %s",
+      netaddr_to_string(&nbuf, &victim->target.addr));
+
+  /* node might stay as a virtual node if other nodes link to it */
+  memcpy(&addr, &victim->target.addr, sizeof(addr));
+  olsrv2_tc_node_remove(victim);
+
+  victim = olsrv2_tc_node_get(&addr);
+  if (victim) {
+    _remove_virtual_node(victim);
+  }
+  return true;
+}
+
+/**
+ * Remove a virtual node by removing all edges pointing to it
+ * @param node pointer to virtual tc node
+ */
+static void
+_remove_virtual_node(struct olsrv2_tc_node *node) {
+  struct olsrv2_tc_edge *edge;
+
+  /*
+   * all edges of a virtual node are virtual inverse edges, removing
+   * the last one removes the node too
+   */
+  do {
+    edge = avl_first_element(&node->_edges, edge, _node);
+  } while (!_remove_edge(edge->inverse, true));
+}
+
+/**
+ * @param originator originator address of a tc node
+ * @return true if the node is a symmetric neighbor or reachable
+ *   through the current routing table
+ */
+static bool
+_is_preferred(const struct netaddr *originator) {
+  struct nhdp_neighbor *neigh;
+  struct nhdp_domain *domain;
+  struct olsrv2_routing_entry *rtentry;
+
+  neigh = nhdp_db_neighbor_get_by_originator(originator);
+  if (neigh != NULL && neigh->symmetric > 0) {
+    return true;
+  }
+
+  list_for_each_element(&nhdp_domain_list, domain, _node) {
+    rtentry = avl_find_element(&olsrv2_routing_tree[domain->index],
+        originator, rtentry, _node);
+    if (rtentry != NULL && rtentry->set) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Move a tc node to its position in the expiry tree
+ * @param node pointer to tc node
+ * @param vtime validity time of node, 0 for a virtual node
+ */
+static void
+_set_expiry(struct olsrv2_tc_node *node, uint64_t vtime) {
+  avl_remove(&_expiry_tree, &node->_expiry_node);
+  node->_expiry = vtime == 0 ? 0 : oonf_clock_getNow() + vtime;
+  avl_insert(&_expiry_tree, &node->_expiry_node);
+}
+
+/**
+ * AVL comparator for absolute expiry times
+ * @param k1 pointer to first expiry time
+ * @param k2 pointer to second expiry time
+ * @return -1 if k1 is earlier, 1 if k2 is earlier, 0 otherwise
+ */
+static int
+_avl_comp_expiry(const void *k1, const void *k2) {
+  const uint64_t *e1 = k1, *e2 = k2;
+
+  if (*e1 < *e2) {
+    return -1;
+  }
+  return *e1 > *e2 ? 1 : 0;
+}
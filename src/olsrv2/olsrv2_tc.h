@@ -53,6 +53,11 @@
 
 #include "olsrv2/olsrv2_routing.h"
 
+#define OLSRV2_CLASS_TC_NODE       "olsrv2 tc node"
+#define OLSRV2_CLASS_TC_EDGE       "olsrv2 tc edge"
+#define OLSRV2_CLASS_ATTACHED      "olsrv2 tc attached network"
+#define OLSRV2_CLASS_ENDPOINT      "olsrv2 tc attached network endpoint"
+
 enum olsrv2_target_type {
   OLSRV2_NODE_TARGET,
   OLSRV2_ADDRESS_TARGET,
@@ -93,14 +98,35 @@ struct olsrv2_tc_node {
   /* time until this node has to be removed */
   struct oonf_timer_entry _validity_time;
 
+  /* time until outdated data of an incomplete TC is removed */
+  struct oonf_timer_entry _sweep_time;
+
+  /* answer set number the sweep timer has been started for */
+  uint16_t _sweep_ansn;
+
   /* tree of olsrv2_tc_edges */
   struct avl_tree _edges;
 
   /* tree of olsrv2_tc_attached_networks */
   struct avl_tree _endpoints;
 
+  /* number of non-virtual edges and attachments of this node */
+  uint32_t _advertised_count;
+
+  /* absolute validity time of the node, 0 for virtual nodes */
+  uint64_t _expiry;
+
   /* node for tree of tc_nodes */
   struct avl_node _originator_node;
+
+  /* node for tree of tc_nodes ordered by expiry */
+  struct avl_node _expiry_node;
+};
+
+/* per-domain data of a tc edge */
+struct olsrv2_tc_edge_domaindata {
+  /* link cost of edge */
+  uint32_t cost;
 };
 
 /* represents an edge between two tc nodes */
@@ -114,9 +140,6 @@ struct olsrv2_tc_edge {
   /* pointer to inverse edge */
   struct olsrv2_tc_edge *inverse;
 
-  /* link cost of edge */
-  uint32_t cost[NHDP_MAXIMUM_DOMAINS];
-
   /* answer set number which set this edge */
   uint16_t ansn;
 
@@ -130,6 +153,15 @@ struct olsrv2_tc_edge {
   struct avl_node _node;
 };
 
+/* per-domain data of a tc attachment */
+struct olsrv2_tc_attachment_domaindata {
+  /* link cost of edge */
+  uint32_t cost;
+
+  /* distance to attached network */
+  uint8_t distance;
+};
+
 /*
  * represents a connection from a tc node to
  * an endpoint, either a neighbor address or an attached network
@@ -141,12 +173,6 @@ struct olsrv2_tc_attachment {
   /* pointer to destination of edge */
   struct olsrv2_tc_endpoint *dst;
 
-  /* link cost of edge */
-  uint32_t cost[NHDP_MAXIMUM_DOMAINS];
-
-  /* distance to attached network */
-  uint8_t distance[NHDP_MAXIMUM_DOMAINS];
-
   /* answer set number which set this edge */
   uint16_t ansn;
 
@@ -177,21 +203,33 @@ struct olsrv2_tc_endpoint {
 EXPORT extern struct avl_tree olsrv2_tc_tree;
 EXPORT extern struct avl_tree olsrv2_tc_endpoint_tree;
 
+EXPORT extern struct nhdp_domain_classdata olsrv2_tc_edge_classdata;
+EXPORT extern struct nhdp_domain_classdata olsrv2_tc_attachment_classdata;
+
 void olsrv2_tc_init(void);
 void olsrv2_tc_cleanup(void);
 
+EXPORT void olsrv2_tc_set_limits(uint32_t max_nodes,
+    uint32_t max_edges, uint32_t max_endpoints);
+
 EXPORT struct olsrv2_tc_node *olsrv2_tc_node_add(
     struct netaddr *, uint64_t vtime, uint16_t ansn);
 EXPORT void olsrv2_tc_node_remove(struct olsrv2_tc_node *);
+EXPORT void olsrv2_tc_node_sweep(struct olsrv2_tc_node *);
+EXPORT void olsrv2_tc_node_delay_sweep(
+    struct olsrv2_tc_node *, uint64_t hold_time);
 
 EXPORT struct olsrv2_tc_edge *olsrv2_tc_edge_add(
     struct olsrv2_tc_node *, struct netaddr *);
 EXPORT bool olsrv2_tc_edge_remove(struct olsrv2_tc_edge *);
+EXPORT void olsrv2_tc_edge_changed(struct olsrv2_tc_edge *);
 
 EXPORT struct olsrv2_tc_attachment *olsrv2_tc_endpoint_add(
     struct olsrv2_tc_node *, struct netaddr *, bool mesh);
 EXPORT void olsrv2_tc_endpoint_remove(
     struct olsrv2_tc_attachment *);
+EXPORT void olsrv2_tc_endpoint_changed(
+    struct olsrv2_tc_attachment *);
 
 /**
  * @param originator originator address of a tc node
@@ -214,4 +252,27 @@ olsrv2_tc_endpoint_get(struct netaddr *prefix) {
 
   return avl_find_element(&olsrv2_tc_endpoint_tree, prefix, end, _node);
 }
+
+/**
+ * @param domain NHDP domain
+ * @param edge tc edge
+ * @return domain data of tc edge
+ */
+static INLINE struct olsrv2_tc_edge_domaindata *
+olsrv2_tc_edge_get_domaindata(
+    struct nhdp_domain *domain, struct olsrv2_tc_edge *edge) {
+  return nhdp_domain_get_classdata(&olsrv2_tc_edge_classdata, domain, edge);
+}
+
+/**
+ * @param domain NHDP domain
+ * @param attached tc attachment
+ * @return domain data of tc attachment
+ */
+static INLINE struct olsrv2_tc_attachment_domaindata *
+olsrv2_tc_attachment_get_domaindata(
+    struct nhdp_domain *domain, struct olsrv2_tc_attachment *attached) {
+  return nhdp_domain_get_classdata(
+      &olsrv2_tc_attachment_classdata, domain, attached);
+}
 #endif /* OLSRV2_TC_H_ */
@@ -39,6 +39,8 @@
  *
  */
 
+#include <stdlib.h>
+
 #include "common/avl.h"
 #include "common/common_types.h"
 #include "common/list.h"
@@ -49,10 +51,12 @@
 #include "core/oonf_logging.h"
 #include "subsystems/oonf_class.h"
 #include "subsystems/oonf_rfc5444.h"
+#include "subsystems/oonf_timer.h"
 
 #include "nhdp/nhdp_interfaces.h"
 #include "nhdp/nhdp_db.h"
 #include "nhdp/nhdp_domain.h"
+#include "nhdp/nhdp_writer.h"
 
 #include "olsrv2/olsrv2.h"
 #include "olsrv2/olsrv2_lan.h"
@@ -65,8 +69,74 @@ enum {
   IDX_ADDRTLV_GATEWAY,
 };
 
+/* advertised state of a neighbor in the TC */
+struct _tc_neighbor {
+  /* pointer to NHDP neighbor */
+  struct nhdp_neighbor *neigh;
+
+  /* originator of the neighbor when the state was recorded */
+  struct netaddr originator;
+
+  /*
+   * encoded linkmetric tlv values (network byte order) per domain,
+   * slot 0 for incoming (or combined) metric, slot 1 for outgoing metric
+   */
+  uint16_t metric[NHDP_MAXIMUM_DOMAINS][2];
+
+  /* bitmask of used linkmetric slots per domain */
+  uint8_t metric_slots[NHDP_MAXIMUM_DOMAINS];
+};
+
+/* advertised neighbor address in the TC */
+struct _tc_address {
+  /* neighbor address */
+  struct netaddr addr;
+
+  /* value of NBR_ADDR_TYPE tlv */
+  uint8_t nbr_addrtype;
+
+  /* index of the neighbor in the neighbor cache */
+  size_t neigh_idx;
+};
+
+/* cached neighbor addresses of one address family */
+struct _tc_address_cache {
+  struct _tc_address *addr;
+  size_t count, size;
+};
+
+/* position of a NHDP neighbor in the TC cache */
+struct _tc_neighbor_ext {
+  /* index of the neighbor in the neighbor cache */
+  size_t idx;
+
+  /* true if the neighbor is part of the neighbor cache */
+  bool advertised;
+};
+
+/* cached neighbors and addresses of a TC */
+struct _tc_cache {
+  struct _tc_neighbor *neighbors;
+  size_t neighbor_count, neighbor_size;
+
+  /* neighbor addresses for IPv4 and IPv6 */
+  struct _tc_address_cache addresses[2];
+};
+
 /* Prototypes */
 static void _send_tc(int af_type);
+static void _invalidate_cache(void);
+static int _update_cache(void);
+static int _rebuild_cache(void);
+static bool _cache_differs(struct _tc_cache *, struct _tc_cache *);
+static bool _get_neighbor_state(
+    struct _tc_neighbor *state, struct nhdp_neighbor *neigh);
+static bool _neighbor_state_changed(struct nhdp_neighbor *neigh);
+static void _cb_nhdp_update(struct nhdp_neighbor *);
+static void _cb_neighbor_change(void *);
+static void _cb_domain_change(void *);
+static void _cb_update_cache(void *);
+static int _cb_compare_tc_address(const void *, const void *);
 #if 0
 static bool _cb_tc_interface_selector(struct rfc5444_writer *,
     struct rfc5444_writer_target *rfc5444_target, void *ptr);
@@ -105,10 +175,57 @@ static struct oonf_class_extension _domain_listener = {
   .class_name = NHDP_CLASS_DOMAIN,
 
   .cb_add = _cb_initialize_gatewaytlv,
+  .cb_change = _cb_domain_change,
+};
+
+/* listeners to invalidate the cached TC neighbor addresses */
+static struct nhdp_domain_listener _nhdp_listener = {
+  .update = _cb_nhdp_update,
 };
 
+/* position of each neighbor in the TC cache */
+static struct oonf_class_extension _neighbor_extension = {
+  .ext_name = "olsrv2 writer",
+  .class_name = NHDP_CLASS_NEIGHBOR,
+  .size = sizeof(struct _tc_neighbor_ext),
+
+  .cb_add = _cb_neighbor_change,
+  .cb_remove = _cb_neighbor_change,
+};
+
+static struct oonf_class_extension _naddr_listener = {
+  .ext_name = "olsrv2 writer",
+  .class_name = NHDP_CLASS_NEIGHBOR_ADDRESS,
+
+  .cb_add = _cb_neighbor_change,
+  .cb_remove = _cb_neighbor_change,
+};
+
+/* timer to rebuild the TC cache after a burst of NHDP changes */
+static struct oonf_timer_info _cache_timer_info = {
+  .name = "olsrv2 TC cache update",
+  .callback = _cb_update_cache,
+};
+
+static struct oonf_timer_entry _cache_timer = {
+  .info = &_cache_timer_info,
+};
+
+/*
+ * cache of advertised neighbors and their addresses, rebuilt only if
+ * they changed. The previous content is kept in the second buffer
+ * to detect if the rebuilt cache changed the advertised topology.
+ */
+static struct _tc_cache _tc_cache_buffer[2];
+static struct _tc_cache *_tc_cache = &_tc_cache_buffer[0];
+
+static bool _tc_cache_valid = false;
+
 static int _send_msg_af;
 
+/* true until the first fragment of the current TC is finished */
+static bool _first_fragment;
+
 static struct oonf_rfc5444_protocol *_protocol;
 
 static bool _cleanedup = false;
@@ -141,7 +258,20 @@ olsrv2_writer_init(struct oonf_rfc5444_protocol *protocol) {
     return -1;
   }
 
+  if (oonf_class_extension_add(&_neighbor_extension)) {
+    OONF_WARN(LOG_OLSRV2, "Could not register OLSRV2 TC cache");
+    rfc5444_writer_unregister_content_provider(
+        &_protocol->writer, &_olsrv2_msgcontent_provider,
+        _olsrv2_addrtlvs, ARRAYSIZE(_olsrv2_addrtlvs));
+    rfc5444_writer_unregister_message(&_protocol->writer, _olsrv2_message);
+    return -1;
+  }
+
+  oonf_timer_add(&_cache_timer_info);
+
   oonf_class_extension_add(&_domain_listener);
+  oonf_class_extension_add(&_naddr_listener);
+  nhdp_domain_listener_add(&_nhdp_listener);
   return 0;
 }
 
@@ -150,12 +280,28 @@ olsrv2_writer_init(struct oonf_rfc5444_protocol *protocol) {
  */
 void
 olsrv2_writer_cleanup(void) {
-  int i;
+  int i, j;
 
   _cleanedup = true;
 
+  nhdp_domain_listener_remove(&_nhdp_listener);
+  oonf_class_extension_remove(&_naddr_listener);
+  oonf_class_extension_remove(&_neighbor_extension);
   oonf_class_extension_remove(&_domain_listener);
 
+  oonf_timer_stop(&_cache_timer);
+  oonf_timer_remove(&_cache_timer_info);
+
+  /* free TC cache */
+  _tc_cache_valid = false;
+  for (i=0; i<2; i++) {
+    free(_tc_cache_buffer[i].neighbors);
+    for (j=0; j<2; j++) {
+      free(_tc_cache_buffer[i].addresses[j].addr);
+    }
+    memset(&_tc_cache_buffer[i], 0, sizeof(_tc_cache_buffer[i]));
+  }
+
   /* unregister address tlvs */
   for (i=0; i<NHDP_MAXIMUM_DOMAINS; i++) {
     if (_gateway_addrtlvs[i].type) {
@@ -184,6 +330,31 @@ olsrv2_writer_send_tc(void) {
   _send_tc(AF_INET6);
 }
 
+/**
+ * Mark the cached neighbor addresses of the TC as outdated,
+ * they will be regenerated soon and trigger a TC if the
+ * advertised topology changed.
+ * Must be called if a TC relevant setting outside of the NHDP
+ * database changes (e.g. the routable ACL).
+ */
+void
+olsrv2_writer_invalidate_tc(void) {
+  _invalidate_cache();
+}
+
+/**
+ * Regenerate the cached neighbor addresses of the TC if they are
+ * outdated. Triggers a TC if the advertised topology changed, so
+ * this should be called before the interval of the next TC is
+ * calculated.
+ */
+void
+olsrv2_writer_update_tc(void) {
+  if (!_tc_cache_valid && _update_cache()) {
+    OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 TC cache");
+  }
+}
+
 /**
  * Send a TC for a specified address family if the originator is set
  * @param af_type address family type
@@ -194,6 +365,11 @@ _send_tc(int af_type) {
 
   originator = olsrv2_originator_get(af_type);
   if (netaddr_get_address_family(originator) == af_type) {
+    if (!_tc_cache_valid && _update_cache()) {
+      OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 TC cache");
+      return;
+    }
+
     _send_msg_af = af_type;
     OONF_INFO(LOG_OLSRV2_W, "Emit IPv%d TC message.", af_type == AF_INET ? 4 : 6);
     oonf_rfc5444_send_all(_protocol, RFC5444_MSGTYPE_TC, nhdp_flooding_selector);
@@ -236,6 +412,7 @@ _cb_addMessageHeader(struct rfc5444_writer *writer,
   rfc5444_writer_set_msg_hoplimit(writer, message, 255);
   rfc5444_writer_set_msg_seqno(writer, message,
       oonf_rfc5444_get_next_message_seqno(_protocol));
+  _first_fragment = true;
 
   OONF_DEBUG(LOG_OLSRV2_W, "Generate TC");
 }
@@ -262,16 +439,35 @@ _cb_addMessageTLVs(struct rfc5444_writer *writer) {
       &itime_encoded, sizeof(itime_encoded));
 }
 
-static void
-_generate_neighbor_metric_tlvs(struct rfc5444_writer *writer,
-    struct rfc5444_writer_address *addr, struct nhdp_neighbor *neigh) {
+/**
+ * Calculate the advertised state of a neighbor
+ * @param state pointer to state buffer
+ * @param neigh pointer to NHDP neighbor
+ * @return true if neighbor has selected us as a MPR and
+ *   will be advertised, false otherwise
+ */
+static bool
+_get_neighbor_state(struct _tc_neighbor *state, struct nhdp_neighbor *neigh) {
   struct nhdp_neighbor_domaindata *neigh_domain;
   struct nhdp_domain *domain;
   uint32_t metric_in, metric_out;
   uint16_t metric_in_encoded, metric_out_encoded;
+  bool advertised;
+  int idx;
 
+  memset(state, 0, sizeof(*state));
+  state->neigh = neigh;
+  memcpy(&state->originator, &neigh->originator, sizeof(state->originator));
+
+  advertised = false;
   list_for_each_element(&nhdp_domain_list, domain, _node) {
     neigh_domain = nhdp_domain_get_neighbordata(domain, neigh);
+    idx = domain->index;
+
+    if (neigh_domain->local_is_mpr) {
+      /* we have been selected as a MPR by this neighbor */
+      advertised = true;
+    }
 
     metric_in = neigh_domain->metric.in;
     metric_in_encoded = rfc5444_metric_encode(metric_in);
@@ -279,104 +475,241 @@ _generate_neighbor_metric_tlvs(struct rfc5444_writer *writer,
     metric_out = neigh_domain->metric.out;
     metric_out_encoded = rfc5444_metric_encode(metric_out);
 
-    if (!nhdp_domain_get_neighbordata(domain, neigh)->neigh_is_mpr) {
-      /* just put in an empty metric so we don't need to start a second TLV */
-      metric_in_encoded = 0;
-
-      OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
-          domain->ext, metric_in_encoded);
-      metric_in_encoded = htons(metric_in_encoded);
-      rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
-          &metric_in_encoded, sizeof(metric_in_encoded), true);
+    if (!neigh_domain->local_is_mpr) {
+      /*
+       * neighbor is not a routing MPR selector in this domain, just put
+       * in an empty metric so we don't need to start a second TLV
+       */
+      state->metric[idx][0] = 0;
+      state->metric_slots[idx] = 1 << 0;
     }
     else if (metric_in_encoded == metric_out_encoded) {
       /* incoming and outgoing metric are the same */
       if (metric_in < RFC5444_METRIC_INFINITE) {
         metric_in_encoded |= RFC5444_LINKMETRIC_INCOMING_NEIGH;
         metric_in_encoded |= RFC5444_LINKMETRIC_OUTGOING_NEIGH;
-
-        OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
-            domain->ext, metric_in_encoded);
       }
 
-      metric_in_encoded = htons(metric_in_encoded);
-      rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[0],
-          &metric_in_encoded, sizeof(metric_in_encoded), true);
+      state->metric[idx][0] = htons(metric_in_encoded);
+      state->metric_slots[idx] = 1 << 0;
     }
     else {
-      int metric_index = 0;
-
       /* different metrics for incoming and outgoing link */
       if (metric_in < RFC5444_METRIC_INFINITE) {
         metric_in_encoded |= RFC5444_LINKMETRIC_INCOMING_NEIGH;
-
-        OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
-            domain->ext, metric_in_encoded);
-        metric_in_encoded = htons(metric_in_encoded);
-        rfc5444_writer_add_addrtlv(writer, addr,
-            &domain->_metric_addrtlvs[metric_index++],
-            &metric_in_encoded, sizeof(metric_in_encoded), true);
+        state->metric[idx][0] = htons(metric_in_encoded);
+        state->metric_slots[idx] |= 1 << 0;
       }
 
       if (metric_out < RFC5444_METRIC_INFINITE) {
         metric_out_encoded |= RFC5444_LINKMETRIC_OUTGOING_NEIGH;
-
-        OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
-            domain->ext, metric_out_encoded);
-        metric_out_encoded = htons(metric_out_encoded);
-        rfc5444_writer_add_addrtlv(writer, addr,
-          &domain->_metric_addrtlvs[metric_index++],
-          &metric_out_encoded, sizeof(metric_out_encoded), true);
+        state->metric[idx][1] = htons(metric_out_encoded);
+        state->metric_slots[idx] |= 1 << 1;
       }
     }
   }
+  return advertised;
 }
 
 /**
- * Callback for rfc5444 writer to add addresses and addresstlvs to tc
- * @param writer
+ * Check if the advertised state of a neighbor differs from
+ * the cached one.
+ * @param neigh pointer to NHDP neighbor
+ * @return true if the TC cache has to be rebuild, false otherwise
+ */
+static bool
+_neighbor_state_changed(struct nhdp_neighbor *neigh) {
+  struct _tc_neighbor_ext *ext;
+  struct _tc_neighbor state;
+  bool advertised;
+
+  ext = oonf_class_get_extension(&_neighbor_extension, neigh);
+  advertised = _get_neighbor_state(&state, neigh);
+
+  if (!ext->advertised) {
+    /* neighbor was not advertised up to now */
+    return advertised;
+  }
+  return !advertised
+      || memcmp(&state, &_tc_cache->neighbors[ext->idx], sizeof(state)) != 0;
+}
+
+/**
+ * Mark TC cache as outdated and schedule its regeneration. This does
+ * not trigger a TC by itself, the rebuilt cache is compared to the
+ * old one first.
  */
 static void
-_cb_addAddresses(struct rfc5444_writer *writer) {
+_invalidate_cache(void) {
+  _tc_cache_valid = false;
+
+  if (!oonf_timer_is_active(&_cache_timer)) {
+    /* collect all changes of the current NHDP update */
+    oonf_timer_set(&_cache_timer, 1);
+  }
+}
+
+/**
+ * Regenerate the TC cache and trigger a TC if the advertised
+ * neighbor addresses or their TLV values changed
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_update_cache(void) {
+  struct _tc_cache *old_cache;
+
+  oonf_timer_stop(&_cache_timer);
+
+  old_cache = _tc_cache;
+  _tc_cache = &_tc_cache_buffer[old_cache == &_tc_cache_buffer[0] ? 1 : 0];
+
+  if (_rebuild_cache()) {
+    /* keep the old cache, it will be rebuilt before the next TC */
+    _tc_cache = old_cache;
+    return -1;
+  }
+
+  if (_cache_differs(old_cache, _tc_cache)) {
+    /* advertised topology changed, send a new TC soon */
+    OONF_DEBUG(LOG_OLSRV2_W, "Advertised topology changed");
+    olsrv2_trigger_tc();
+  }
+  return 0;
+}
+
+/**
+ * Compare the advertised content of two TC caches
+ * @param cache1 pointer to first TC cache
+ * @param cache2 pointer to second TC cache
+ * @return true if the caches advertise different addresses
+ *   or TLV values, false otherwise
+ */
+static bool
+_cache_differs(struct _tc_cache *cache1, struct _tc_cache *cache2) {
+  struct _tc_address *addr1, *addr2;
+  struct _tc_neighbor *neigh1, *neigh2;
+  size_t i;
+  int af;
+
+  for (af=0; af<2; af++) {
+    if (cache1->addresses[af].count != cache2->addresses[af].count) {
+      return true;
+    }
+
+    /* both caches are sorted the same way */
+    for (i=0; i<cache1->addresses[af].count; i++) {
+      addr1 = &cache1->addresses[af].addr[i];
+      addr2 = &cache2->addresses[af].addr[i];
+
+      if (netaddr_cmp(&addr1->addr, &addr2->addr) != 0
+          || addr1->nbr_addrtype != addr2->nbr_addrtype) {
+        return true;
+      }
+
+      neigh1 = &cache1->neighbors[addr1->neigh_idx];
+      neigh2 = &cache2->neighbors[addr2->neigh_idx];
+      if (memcmp(neigh1->metric_slots, neigh2->metric_slots,
+            sizeof(neigh1->metric_slots)) != 0
+          || memcmp(neigh1->metric, neigh2->metric,
+            sizeof(neigh1->metric)) != 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Add an address to the TC cache
+ * @param cache pointer to address cache of the address family
+ * @param addr neighbor address
+ * @param nbr_addrtype value of NBR_ADDR_TYPE tlv
+ * @param neigh_idx index of neighbor in neighbor cache
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_add_cached_address(struct _tc_address_cache *cache,
+    const struct netaddr *addr, uint8_t nbr_addrtype, size_t neigh_idx) {
+  struct _tc_address *array;
+  size_t size;
+
+  if (cache->count == cache->size) {
+    size = cache->size ? cache->size * 2 : 16;
+    array = realloc(cache->addr, sizeof(*array) * size);
+    if (array == NULL) {
+      return -1;
+    }
+    cache->addr = array;
+    cache->size = size;
+  }
+
+  memcpy(&cache->addr[cache->count].addr, addr, sizeof(*addr));
+  cache->addr[cache->count].nbr_addrtype = nbr_addrtype;
+  cache->addr[cache->count].neigh_idx = neigh_idx;
+  cache->count++;
+  return 0;
+}
+
+/**
+ * Regenerate the cached neighbor addresses and tlv values of the TC
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_rebuild_cache(void) {
   const struct netaddr_acl *routable_acl;
-  struct rfc5444_writer_address *addr;
+  struct _tc_address_cache *cache;
+  struct _tc_neighbor_ext *ext;
+  struct _tc_neighbor *array;
   struct nhdp_neighbor *neigh;
   struct nhdp_naddr *naddr;
-  struct nhdp_domain *domain;
-  struct olsrv2_lan_entry *lan;
-  bool any_advertised;
   uint8_t nbr_addrtype_value;
-  uint32_t metric_out;
-  uint16_t metric_out_encoded;
+  size_t size;
 
 #ifdef OONF_LOG_DEBUG_INFO
   struct netaddr_str buf;
 #endif
 
+  OONF_DEBUG(LOG_OLSRV2_W, "Rebuild TC cache");
+
   routable_acl = olsrv2_get_routable();
 
+  _tc_cache->neighbor_count = 0;
+  _tc_cache->addresses[0].count = 0;
+  _tc_cache->addresses[1].count = 0;
+
   /* iterate over neighbors */
   list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
-    any_advertised = false;
-    /* see if we have been selected as a MPR by this neighbor */
-    list_for_each_element(&nhdp_domain_list, domain, _node) {
-      if (nhdp_domain_get_neighbordata(domain, neigh)->local_is_mpr) {
-        /* found one */
-        any_advertised = true;
-        break;
+    if (_tc_cache->neighbor_count == _tc_cache->neighbor_size) {
+      size = _tc_cache->neighbor_size ? _tc_cache->neighbor_size * 2 : 16;
+      array = realloc(_tc_cache->neighbors, sizeof(*array) * size);
+      if (array == NULL) {
+        return -1;
       }
+      _tc_cache->neighbors = array;
+      _tc_cache->neighbor_size = size;
     }
 
-    if (!any_advertised) {
+    ext = oonf_class_get_extension(&_neighbor_extension, neigh);
+    ext->idx = _tc_cache->neighbor_count;
+    ext->advertised = _get_neighbor_state(
+        &_tc_cache->neighbors[_tc_cache->neighbor_count], neigh);
+
+    if (!ext->advertised) {
       /* we are not a MPR for this neighbor, so we don't advertise the neighbor */
       continue;
     }
 
     /* iterate over neighbors addresses */
     avl_for_each_element(&neigh->_neigh_addresses, naddr, _neigh_node) {
-      if (netaddr_get_address_family(&naddr->neigh_addr) != _send_msg_af) {
-        /* wrong address family, skip this one */
-        continue;
+      switch (netaddr_get_address_family(&naddr->neigh_addr)) {
+        case AF_INET:
+          cache = &_tc_cache->addresses[0];
+          break;
+        case AF_INET6:
+          cache = &_tc_cache->addresses[1];
+          break;
+        default:
+          continue;
       }
 
       nbr_addrtype_value = 0;
@@ -396,22 +729,123 @@ _cb_addAddresses(struct rfc5444_writer *writer) {
         continue;
       }
 
-      OONF_DEBUG(LOG_OLSRV2_W, "Add address %s to TC",
-          netaddr_to_string(&buf, &naddr->neigh_addr));
-      addr = rfc5444_writer_add_address(writer, _olsrv2_msgcontent_provider.creator,
-          &naddr->neigh_addr, false);
-      if (addr == NULL) {
-        OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 address");
-        return;
+      if (_add_cached_address(cache, &naddr->neigh_addr,
+          nbr_addrtype_value, _tc_cache->neighbor_count)) {
+        return -1;
       }
+    }
+
+    _tc_cache->neighbor_count++;
+  }
+
+  /* order addresses for best compression */
+  qsort(_tc_cache->addresses[0].addr, _tc_cache->addresses[0].count,
+      sizeof(struct _tc_address), _cb_compare_tc_address);
+  qsort(_tc_cache->addresses[1].addr, _tc_cache->addresses[1].count,
+      sizeof(struct _tc_address), _cb_compare_tc_address);
+
+  _tc_cache_valid = true;
+  return 0;
+}
+
+/**
+ * Callback for qsort to order the neighbor addresses of a TC. Addresses
+ * are grouped by their network part first, then by identical TLV values
+ * and finally by the address itself, which allows the RFC5444 writer
+ * to use long common heads and single value TLVs over address ranges.
+ * @param p1 pointer to first tc address
+ * @param p2 pointer to second tc address
+ * @return <0, 0 or >0 like memcmp()
+ */
+static int
+_cb_compare_tc_address(const void *p1, const void *p2) {
+  const struct _tc_address *a1 = p1, *a2 = p2;
+  const struct _tc_neighbor *n1, *n2;
+  int result;
+
+  result = nhdp_writer_compare_address_group(&a1->addr, &a2->addr);
+  if (result != 0) {
+    return result;
+  }
+
+  result = (int)a1->nbr_addrtype - (int)a2->nbr_addrtype;
+  if (result != 0) {
+    return result;
+  }
+
+  n1 = &_tc_cache->neighbors[a1->neigh_idx];
+  n2 = &_tc_cache->neighbors[a2->neigh_idx];
+  result = memcmp(n1->metric_slots, n2->metric_slots, sizeof(n1->metric_slots));
+  if (result != 0) {
+    return result;
+  }
+  result = memcmp(n1->metric, n2->metric, sizeof(n1->metric));
+  if (result != 0) {
+    return result;
+  }
+  return netaddr_cmp(&a1->addr, &a2->addr);
+}
+
+/**
+ * Callback for rfc5444 writer to add addresses and addresstlvs to tc
+ * @param writer
+ */
+static void
+_cb_addAddresses(struct rfc5444_writer *writer) {
+  struct rfc5444_writer_address *addr;
+  struct _tc_address_cache *cache;
+  struct _tc_address *entry;
+  struct _tc_neighbor *state;
+  struct nhdp_domain *domain;
+  struct olsrv2_lan_entry *lan;
+  uint32_t metric_out;
+  uint16_t metric_out_encoded;
+  size_t i;
+  int j;
+
+#ifdef OONF_LOG_DEBUG_INFO
+  struct netaddr_str buf;
+#endif
 
-      /* add neighbor type TLV */
-      OONF_DEBUG(LOG_OLSRV2_W, "Add NBRAddrType TLV with value %u", nbr_addrtype_value);
-      rfc5444_writer_add_addrtlv(writer, addr, &_olsrv2_addrtlvs[IDX_ADDRTLV_NBR_ADDR_TYPE],
-          &nbr_addrtype_value, sizeof(nbr_addrtype_value), false);
+  cache = &_tc_cache->addresses[_send_msg_af == AF_INET ? 0 : 1];
 
-      /* add linkmetric TLVs */
-      _generate_neighbor_metric_tlvs(writer, addr, neigh);
+  /* copy neighbor addresses and tlvs from the cache */
+  for (i=0; i<cache->count; i++) {
+    entry = &cache->addr[i];
+    state = &_tc_cache->neighbors[entry->neigh_idx];
+
+    OONF_DEBUG(LOG_OLSRV2_W, "Add address %s to TC",
+        netaddr_to_string(&buf, &entry->addr));
+    addr = rfc5444_writer_add_address(writer, _olsrv2_msgcontent_provider.creator,
+        &entry->addr, false);
+    if (addr == NULL) {
+      OONF_WARN(LOG_OLSRV2_W, "Out of memory error for olsrv2 address");
+      return;
+    }
+
+    /* add neighbor type TLV */
+    OONF_DEBUG(LOG_OLSRV2_W, "Add NBRAddrType TLV with value %u", entry->nbr_addrtype);
+    rfc5444_writer_add_addrtlv(writer, addr, &_olsrv2_addrtlvs[IDX_ADDRTLV_NBR_ADDR_TYPE],
+        &entry->nbr_addrtype, sizeof(entry->nbr_addrtype), false);
+
+    /*
+     * add linkmetric TLVs, each kind of metric value always uses the same
+     * tlv slot and duplicates are only allowed for the second metric of
+     * a domain, so the RFC5444 writer can merge the metric TLVs of
+     * neighboring addresses into single value or multivalue TLVs
+     */
+    list_for_each_element(&nhdp_domain_list, domain, _node) {
+      for (j=0; j<2; j++) {
+        if ((state->metric_slots[domain->index] & (1 << j)) == 0) {
+          continue;
+        }
+
+        OONF_DEBUG(LOG_OLSRV2_W, "Add Linkmetric (ext %u) TLV with value 0x%04x",
+            domain->ext, ntohs(state->metric[domain->index][j]));
+        rfc5444_writer_add_addrtlv(writer, addr, &domain->_metric_addrtlvs[j],
+            &state->metric[domain->index][j], sizeof(state->metric[0][0]),
+            (state->metric_slots[domain->index] & ((1 << j) - 1)) != 0);
+      }
     }
   }
 
@@ -468,12 +902,87 @@ _cb_finishMessageTLVs(struct rfc5444_writer *writer,
     struct rfc5444_writer_address *start __attribute__((unused)),
     struct rfc5444_writer_address *end __attribute__((unused)),
     bool complete) {
+  struct oonf_rfc5444_target *target;
+  struct nhdp_interface *interf;
   uint16_t ansn;
 
+  /* count TC in the statistics of the NHDP interface */
+  target = oonf_rfc5444_get_target_from_writer(writer);
+  interf = nhdp_interface_get(target->interface->name);
+  if (interf != NULL) {
+    nhdp_interface_count_message(interf, target);
+  }
+
   /* get ANSN */
   ansn = htons(olsrv2_update_ansn());
 
   rfc5444_writer_set_messagetlv(writer, RFC5444_MSGTLV_CONT_SEQ_NUM,
       complete ? RFC5444_CONT_SEQ_NUM_COMPLETE : RFC5444_CONT_SEQ_NUM_INCOMPLETE,
       &ansn, sizeof(ansn));
+
+  if (!_first_fragment) {
+    /*
+     * every fragment of a TC needs its own sequence number, including
+     * the final complete one, otherwise the duplicate set of the
+     * receiver drops all but the first
+     */
+    rfc5444_writer_set_msg_seqno(writer, _olsrv2_message,
+        oonf_rfc5444_get_next_message_seqno(_protocol));
+  }
+  _first_fragment = false;
+}
+
+/**
+ * Callback triggered when the metric or MPR settings of a
+ * NHDP neighbor (or the whole neighborhood) changed
+ * @param neigh pointer to NHDP neighbor, NULL if all neighbors
+ *   might have changed
+ */
+static void
+_cb_nhdp_update(struct nhdp_neighbor *neigh) {
+  if (!_tc_cache_valid) {
+    return;
+  }
+
+  if (neigh != NULL) {
+    if (_neighbor_state_changed(neigh)) {
+      _invalidate_cache();
+    }
+    return;
+  }
+
+  list_for_each_element(&nhdp_neigh_list, neigh, _global_node) {
+    if (_neighbor_state_changed(neigh)) {
+      _invalidate_cache();
+      return;
+    }
+  }
+}
+
+/**
+ * Callback triggered when a NHDP neighbor or neighbor address
+ * is added or removed
+ * @param ptr unused
+ */
+static void
+_cb_neighbor_change(void *ptr __attribute__((unused))) {
+  _invalidate_cache();
+}
+
+/**
+ * Callback triggered when a NHDP domain is reconfigured
+ * @param ptr unused
+ */
+static void
+_cb_domain_change(void *ptr __attribute__((unused))) {
+  _invalidate_cache();
+}
+
+/**
+ * Callback for timer to regenerate the outdated TC cache
+ * @param ptr unused
+ */
+static void
+_cb_update_cache(void *ptr __attribute__((unused))) {
+  olsrv2_writer_update_tc();
 }
@@ -50,5 +50,7 @@ int olsrv2_writer_init(struct oonf_rfc5444_protocol *)
 void olsrv2_writer_cleanup(void);
 
 EXPORT void olsrv2_writer_send_tc(void);
+EXPORT void olsrv2_writer_invalidate_tc(void);
+EXPORT void olsrv2_writer_update_tc(void);
 
 #endif /* OLSRV2_WRITER_H_ */
@@ -62,28 +62,45 @@
 #include "subsystems/oonf_clock.h"
 #include "subsystems/oonf_interface.h"
 #include "subsystems/oonf_socket.h"
+#ifdef OONF_VIRTUAL_CLOCK
+#include "subsystems/oonf_timer.h"
+#endif
 
 #include "app_data.h"
 #include "oonf_api_subsystems.h"
 #include "oonf_setup.h"
 
+#ifdef OONF_VIRTUAL_CLOCK
+#include "oonf_virtual_clock.h"
+#endif
+
 /* prototypes */
 static bool _cb_stop_scheduler(void);
 static void quit_signal_handler(int);
 static void hup_signal_handler(int);
 static void setup_signalhandler(void);
 static int mainloop(int argc, char **argv);
+static int _handle_events(void);
+#ifdef OONF_VIRTUAL_CLOCK
+static int _skip_to_next_event(void);
+#endif
 static void parse_early_commandline(int argc, char **argv);
 static int parse_commandline(int argc, char **argv, bool reload_only);
 static int display_schema(void);
 
 static bool _end_oonf_signal, _display_schema, _debug_early, _ignore_unknown;
+#ifdef OONF_VIRTUAL_CLOCK
+static bool _virtual_clock;
+#endif
 static char *_schema_name;
 
 enum argv_short_options {
   argv_option_schema = 256,
   argv_option_debug_early,
   argv_option_ignore_unknown,
+#ifdef OONF_VIRTUAL_CLOCK
+  argv_option_virtual_clock,
+#endif
 };
 
 static struct option oonf_options[] = {
@@ -102,6 +119,9 @@ static struct option oonf_options[] = {
   { "schema",          optional_argument, 0, argv_option_schema },
   { "Xearlydebug",     no_argument,       0, argv_option_debug_early },
   { "Xignoreunknown",  no_argument,       0, argv_option_ignore_unknown },
+#ifdef OONF_VIRTUAL_CLOCK
+  { "Xvirtualclock",   no_argument,       0, argv_option_virtual_clock },
+#endif
   { NULL, 0,0,0 }
 };
 
@@ -136,6 +156,9 @@ static const char *help_text =
     "Expert/Experimental arguments\n"
     "  --Xearlydebug                          Activate debugging output before configuration could be parsed\n"
     "  --Xignoreunknown                       Ignore unknown command line arguments\n"
+#ifdef OONF_VIRTUAL_CLOCK
+    "  --Xvirtualclock                        Skip the time between timer events instead of waiting\n"
+#endif
     "\n"
     "The remainder of the parameters which are no arguments are handled as interface names.\n"
 ;
@@ -164,6 +187,9 @@ main(int argc, char **argv) {
   _display_schema = false;
   _debug_early = false;
   _ignore_unknown = false;
+#ifdef OONF_VIRTUAL_CLOCK
+  _virtual_clock = false;
+#endif
 
   /* assemble list of subsystems first */
   subsystem_count = get_used_api_subsystem_count()
@@ -193,6 +219,13 @@ main(int argc, char **argv) {
     goto olsrd_cleanup;
   }
 
+#ifdef OONF_VIRTUAL_CLOCK
+  if (_virtual_clock && !oonf_virtual_clock_is_available()) {
+    OONF_WARN(LOG_MAIN, "Virtual clock is not available on this platform");
+    _virtual_clock = false;
+  }
+#endif
+
   /* prepare plugin initialization */
   oonf_plugins_init();
 
@@ -400,7 +433,7 @@ mainloop(int argc, char **argv) {
     }
 
     /* Read incoming data and handle it immediately */
-    if (oonf_socket_handle(_cb_stop_scheduler, 0)) {
+    if (_handle_events()) {
       exit_code = 1;
       break;
     }
@@ -431,6 +464,48 @@ mainloop(int argc, char **argv) {
   return exit_code;
 }
 
+/**
+ * Handle incoming data and due timers
+ * @return -1 if an error happened, 0 otherwise
+ */
+static int
+_handle_events(void) {
+#ifdef OONF_VIRTUAL_CLOCK
+  if (_virtual_clock) {
+    /* handle timers and incoming data for one millisecond */
+    if (oonf_socket_handle(_cb_stop_scheduler, oonf_clock_get_absolute(1))) {
+      return -1;
+    }
+
+    /* jump to the next timer event */
+    return _skip_to_next_event();
+  }
+#endif
+  return oonf_socket_handle(_cb_stop_scheduler, 0);
+}
+
+#ifdef OONF_VIRTUAL_CLOCK
+/**
+ * Advance the virtual clock to the next timer event
+ * @return -1 if the clock could not be updated, 0 otherwise
+ */
+static int
+_skip_to_next_event(void) {
+  uint64_t next_event;
+
+  if (oonf_clock_update()) {
+    return -1;
+  }
+
+  next_event = oonf_timer_getNextEvent();
+  if (next_event > oonf_clock_getNow() && next_event != UINT64_MAX) {
+    oonf_virtual_clock_skip(next_event - oonf_clock_getNow());
+    return oonf_clock_update();
+  }
+  return 0;
+}
+#endif
+
 /**
  * Callback for the scheduler that tells it when to return to the mainloop.
  * @return true if scheduler should return to the mainloop now
@@ -484,6 +559,11 @@ parse_early_commandline(int argc, char **argv) {
       case argv_option_ignore_unknown:
         _ignore_unknown = true;
         break;
+#ifdef OONF_VIRTUAL_CLOCK
+      case argv_option_virtual_clock:
+        _virtual_clock = true;
+        break;
+#endif
       default:
         break;
     }
@@ -544,6 +624,9 @@ parse_commandline(int argc, char **argv, bool reload_only) {
 
       case argv_option_debug_early:
       case argv_option_ignore_unknown:
+#ifdef OONF_VIRTUAL_CLOCK
+      case argv_option_virtual_clock:
+#endif
         /* ignore this here */
         break;
 
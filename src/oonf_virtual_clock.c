@@ -0,0 +1,126 @@
+
+/*
+ * The olsr.org Optimized Link-State Routing daemon version 2 (olsrd2)
+ * Copyright (c) 2004-2013, the olsr.org team - see HISTORY file
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+
+/*
+ * The virtual clock skips the time the main loop would spend waiting
+ * for the next timer. The framework clock reads the monotonic system
+ * clock through clock_gettime(), so the executable provides its own
+ * clock_gettime() that adds the skipped time to the monotonic clocks.
+ * It reads the kernel clocks with the clock_gettime system call, so it
+ * does not depend on symbol lookups in the C library.
+ *
+ * This file is only part of simulation builds (cmake option
+ * OONF_VIRTUAL_CLOCK), the default binary uses the system clock.
+ */
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "common/common_types.h"
+
+#include "oonf_virtual_clock.h"
+
+#if defined(__linux__)
+
+/* time skipped by the virtual clock in milliseconds */
+static uint64_t _skipped = 0;
+
+/**
+ * @return true if the virtual clock is supported on this platform
+ */
+bool
+oonf_virtual_clock_is_available(void) {
+  return true;
+}
+
+/**
+ * Advance the virtual clock
+ * @param interval time in milliseconds the clock should jump forward
+ */
+void
+oonf_virtual_clock_skip(uint64_t interval) {
+  _skipped += interval;
+}
+
+/**
+ * Replacement of the clock_gettime() function of the C library,
+ * adds the skipped time to all monotonic clocks. It must be exported
+ * from the executable, otherwise a dynamically linked framework
+ * library would still bind to the C library.
+ * @param clk_id clock id
+ * @param tp pointer to timespec to store time
+ * @return 0 if successful, -1 if an error happened
+ */
+EXPORT int
+clock_gettime(clockid_t clk_id, struct timespec *tp) {
+  uint64_t nsec;
+  int result;
+
+  result = syscall(SYS_clock_gettime, clk_id, tp);
+  if (result != 0 || _skipped == 0) {
+    return result;
+  }
+
+  if (clk_id == CLOCK_MONOTONIC || clk_id == CLOCK_MONOTONIC_COARSE
+      || clk_id == CLOCK_BOOTTIME) {
+    nsec = (uint64_t)tp->tv_nsec + (_skipped % 1000) * 1000000;
+
+    tp->tv_sec += _skipped / 1000 + nsec / 1000000000;
+    tp->tv_nsec = nsec % 1000000000;
+  }
+  return result;
+}
+
+#else
+
+bool
+oonf_virtual_clock_is_available(void) {
+  return false;
+}
+
+void
+oonf_virtual_clock_skip(uint64_t interval __attribute__((unused))) {
+}
+
+#endif